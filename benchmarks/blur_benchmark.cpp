@@ -0,0 +1,276 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Compares the naive blur shader against the shared-memory blur_kernel.
+ * Runs headless and times both separable blurs (radius 20, like the shell uses) with timestamp queries
+ * at 1080p and 4K, then prints the median GPU time of each and exits.
+ *
+ * Usage: xmbshell-blur-benchmark [frames per resolution]
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+import dreamrender;
+import sdl2;
+import spdlog;
+import vulkan_hpp;
+import vma;
+import xmbshell.blur_kernel;
+
+namespace {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wc23-extensions"
+constexpr char naive_comp_array[] = {
+#embed "benchmarks/blur_naive.comp.spv"
+};
+#pragma clang diagnostic pop
+constexpr std::array naive_comp_shader = dreamrender::convert<std::to_array(naive_comp_array), uint32_t>();
+
+struct NaiveBlurConstants {
+    int axis = 0;
+    int size = 20;
+};
+
+constexpr int blur_size = 20;
+constexpr std::array resolutions = {vk::Extent2D{1920, 1080}, vk::Extent2D{3840, 2160}};
+
+class blur_benchmark : public dreamrender::phase {
+    public:
+        blur_benchmark(dreamrender::window* window, unsigned int frames) : phase(window), frames(frames) {}
+
+        void preload() override {
+            phase::preload();
+
+            kernel = std::make_unique<render::blur_kernel>(device);
+            kernel->preload(win->pipelineCache.get());
+
+            {
+                vk::PushConstantRange range{vk::ShaderStageFlagBits::eCompute, 0, sizeof(NaiveBlurConstants)};
+                vk::DescriptorSetLayout layout = kernel->get_descriptor_set_layout();
+                vk::PipelineLayoutCreateInfo info({}, layout, range);
+                naivePipelineLayout = device.createPipelineLayoutUnique(info);
+
+                vk::UniqueShaderModule compShader = dreamrender::createShader(device, naive_comp_shader);
+                vk::PipelineShaderStageCreateInfo shader({}, vk::ShaderStageFlagBits::eCompute, compShader.get(), "main");
+                vk::ComputePipelineCreateInfo pipeline_info({}, shader, naivePipelineLayout.get());
+                naivePipeline = device.createComputePipelineUnique(win->pipelineCache.get(), pipeline_info).value;
+            }
+
+            {
+                vk::DescriptorPoolSize size(vk::DescriptorType::eStorageImage, 2*resolutions.size());
+                vk::DescriptorPoolCreateInfo pool_info({}, resolutions.size(), size);
+                descriptorPool = device.createDescriptorPoolUnique(pool_info);
+
+                std::vector<vk::DescriptorSetLayout> layouts(resolutions.size(), kernel->get_descriptor_set_layout());
+                descriptorSets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), layouts));
+            }
+            for(unsigned int i=0; i<resolutions.size(); i++) {
+                auto& [src, dst] = images[i];
+                src = std::make_unique<dreamrender::texture>(device, allocator, resolutions[i], vk::ImageUsageFlagBits::eStorage,
+                    vk::Format::eR16G16B16A16Sfloat, vk::SampleCountFlagBits::e1, false, vk::ImageAspectFlagBits::eColor);
+                dst = std::make_unique<dreamrender::texture>(device, allocator, resolutions[i], vk::ImageUsageFlagBits::eStorage,
+                    vk::Format::eR16G16B16A16Sfloat, vk::SampleCountFlagBits::e1, false, vk::ImageAspectFlagBits::eColor);
+
+                std::array<vk::DescriptorImageInfo, 2> infos = {
+                    vk::DescriptorImageInfo({}, src->imageView.get(), vk::ImageLayout::eGeneral),
+                    vk::DescriptorImageInfo({}, dst->imageView.get(), vk::ImageLayout::eGeneral),
+                };
+                vk::WriteDescriptorSet write(descriptorSets[i], 0, 0, infos.size(), vk::DescriptorType::eStorageImage, infos.data());
+                device.updateDescriptorSets(write, {});
+            }
+            timestampPeriod = win->physicalDevice.getProperties().limits.timestampPeriod;
+        }
+
+        void prepare(std::vector<vk::Image> swapchainImages, std::vector<vk::ImageView> swapchainViews) override {
+            phase::prepare(swapchainImages, swapchainViews);
+            this->swapchainImages = swapchainImages;
+
+            // three timestamps per frame: start, after the naive blur and after the blur_kernel
+            queryPool = device.createQueryPoolUnique(vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, 3*swapchainImages.size()));
+            pending.assign(swapchainImages.size(), -1);
+        }
+
+        void render(int frame, vk::Semaphore imageAvailable, vk::Semaphore renderFinished, vk::Fence fence) override {
+            collect(frame);
+
+            unsigned int resolution = recorded / frames;
+            if(resolution >= resolutions.size()) {
+                report();
+                sdl::Event event = {
+                    .quit = {
+                        .type = sdl::EventType::SDL_QUIT,
+                        .timestamp = sdl::GetTicks()
+                    }
+                };
+                sdl::PushEvent(&event);
+                resolution = resolutions.size()-1;
+            }
+            auto& [src, dst] = images[resolution];
+
+            vk::CommandBuffer cmd = commandBuffers[frame];
+            cmd.begin(vk::CommandBufferBeginInfo());
+            cmd.resetQueryPool(queryPool.get(), 3*frame, 3);
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, {
+                vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eShaderRead,
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+                    vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
+                    src->image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)),
+                vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eShaderWrite,
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+                    vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
+                    dst->image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)),
+            });
+            vk::Extent2D extent = resolutions[resolution];
+
+            cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool.get(), 3*frame);
+            {
+                int groupCountX = static_cast<int>((extent.width + 15) / 16);
+                int groupCountY = static_cast<int>((extent.height + 15) / 16);
+                cmd.bindPipeline(vk::PipelineBindPoint::eCompute, naivePipeline.get());
+                cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, naivePipelineLayout.get(), 0, descriptorSets[resolution], {});
+                for(int axis = 0; axis < 2; axis++) {
+                    NaiveBlurConstants constants{axis, blur_size};
+                    cmd.pushConstants(naivePipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(NaiveBlurConstants), &constants);
+                    cmd.dispatch(groupCountX, groupCountY, 1);
+                    compute_barrier(cmd);
+                }
+            }
+            cmd.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, queryPool.get(), 3*frame+1);
+            {
+                kernel->dispatch(cmd, descriptorSets[resolution], render::blur_kernel::axis::horizontal, blur_size, extent);
+                compute_barrier(cmd);
+                kernel->dispatch(cmd, descriptorSets[resolution], render::blur_kernel::axis::vertical, blur_size, extent);
+                compute_barrier(cmd);
+            }
+            cmd.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader, queryPool.get(), 3*frame+2);
+
+            // nothing is drawn, but the swapchain image still has to end up in the layout it is presented in
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, {}, {
+                vk::ImageMemoryBarrier({}, {},
+                    vk::ImageLayout::eUndefined, win->swapchainFinalLayout,
+                    vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
+                    swapchainImages[frame], vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)),
+            });
+            cmd.end();
+
+            pending[frame] = static_cast<int>(resolution);
+
+            vk::PipelineStageFlags waitFlags = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+            vk::SubmitInfo submit_info(imageAvailable, waitFlags, cmd, renderFinished);
+            graphicsQueue.submit(submit_info, fence);
+        }
+    private:
+        static void compute_barrier(vk::CommandBuffer cmd) {
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {},
+                vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite), {}, {});
+        }
+
+        // the fence of this frame has been waited for, so its previous results are available
+        void collect(int frame) {
+            if(pending[frame] < 0) {
+                return;
+            }
+            std::array<uint64_t, 3> timestamps{};
+            auto result = device.getQueryPoolResults(queryPool.get(), 3*frame, 3,
+                sizeof(timestamps), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+            if(result == vk::Result::eSuccess) {
+                auto& [naive, kernel] = samples[pending[frame]];
+                naive.push_back(static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod / 1e6);
+                kernel.push_back(static_cast<double>(timestamps[2] - timestamps[1]) * timestampPeriod / 1e6);
+                recorded++;
+            }
+            pending[frame] = -1;
+        }
+
+        void report() {
+            if(reported) {
+                return;
+            }
+            reported = true;
+
+            auto median = [](std::vector<double> v) {
+                if(v.empty()) {
+                    return 0.0;
+                }
+                std::ranges::nth_element(v, v.begin() + v.size()/2);
+                return v[v.size()/2];
+            };
+            for(unsigned int i=0; i<resolutions.size(); i++) {
+                auto& [naive, kernel] = samples[i];
+                double n = median(naive);
+                double k = median(kernel);
+                spdlog::info("{}x{}: naive blur {:.3f} ms, blur_kernel {:.3f} ms ({:.1f}x faster, radius {}, {} samples)",
+                    resolutions[i].width, resolutions[i].height, n, k, k > 0.0 ? n/k : 0.0, blur_size, naive.size());
+            }
+        }
+
+        unsigned int frames;
+        unsigned int recorded = 0;
+        bool reported = false;
+        float timestampPeriod = 1.0f;
+
+        std::unique_ptr<render::blur_kernel> kernel;
+        vk::UniquePipelineLayout naivePipelineLayout;
+        vk::UniquePipeline naivePipeline;
+
+        vk::UniqueDescriptorPool descriptorPool;
+        std::vector<vk::DescriptorSet> descriptorSets;
+        std::array<std::pair<std::unique_ptr<dreamrender::texture>, std::unique_ptr<dreamrender::texture>>, resolutions.size()> images;
+
+        std::vector<vk::Image> swapchainImages;
+        vk::UniqueQueryPool queryPool;
+        std::vector<int> pending;
+        std::array<std::pair<std::vector<double>, std::vector<double>>, resolutions.size()> samples;
+};
+
+}
+
+#undef main
+int main(int argc, char *argv[])
+{
+    unsigned int frames = argc > 1 ? std::stoul(argv[1]) : 200;
+
+    SDL_SetMainReady();
+
+    dreamrender::window_config window_config;
+    window_config.name = "xmbshell-blur-benchmark";
+    window_config.title = "XMB Blur Benchmark";
+    window_config.width = 256;
+    window_config.height = 256;
+    window_config.headless = true;
+    window_config.headless_output_dir.clear();
+    window_config.preferredPresentMode = vk::PresentModeKHR::eImmediate;
+
+    dreamrender::window window{window_config};
+    window.init();
+
+    auto* benchmark = new blur_benchmark(&window, frames);
+    window.set_phase(benchmark, nullptr, nullptr, nullptr); // window takes ownership of benchmark, no input handling needed
+    window.loop();
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <utility>
+
+export module xmbshell.blur_kernel;
+
+import dreamrender;
+
+import vulkan_hpp;
+
+namespace render {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wc23-extensions"
+constexpr char blur_comp_array[] = {
+#embed "shaders/blur.comp.spv"
+};
+#pragma clang diagnostic pop
+constexpr std::array blur_comp_shader = dreamrender::convert<std::to_array(blur_comp_array), uint32_t>();
+
+/* Pipelines for the separable box blur in shaders/blur.comp.
+ * The shell blurs with render::blur_pass, this is only kept to compare it against the naive blur in the benchmark.
+ * The shader is specialized for each axis and for a few maximum radii,
+ * because the maximum radius decides how much shared memory a workgroup needs.
+ * Descriptor set layout: binding 0 = input storage image, binding 1 = output storage image (both rgba16f, general layout).
+ */
+export class blur_kernel {
+    public:
+        enum class axis : int {
+            horizontal = 0,
+            vertical = 1,
+        };
+        constexpr static std::array radius_buckets = {4, 8, 16, 32};
+        constexpr static unsigned int tile_size = 256; // TILE_SIZE in blur.comp
+
+        blur_kernel(vk::Device device) : device(device) {}
+
+        void preload(vk::PipelineCache pipelineCache = {}) {
+            {
+                std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+                    vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+                    vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+                };
+                vk::DescriptorSetLayoutCreateInfo info({}, bindings);
+                descriptorSetLayout = device.createDescriptorSetLayoutUnique(info);
+            }
+            {
+                vk::PushConstantRange range{vk::ShaderStageFlagBits::eCompute, 0, sizeof(push_constants)};
+                vk::PipelineLayoutCreateInfo info({}, descriptorSetLayout.get(), range);
+                pipelineLayout = device.createPipelineLayoutUnique(info);
+            }
+            {
+                vk::UniqueShaderModule compShader = dreamrender::createShader(device, blur_comp_shader);
+                std::array<vk::SpecializationMapEntry, 2> entries = {
+                    vk::SpecializationMapEntry(0, offsetof(specialization, axis), sizeof(int)),
+                    vk::SpecializationMapEntry(1, offsetof(specialization, max_radius), sizeof(int)),
+                };
+                for(int a = 0; a < 2; a++) {
+                    for(unsigned int r = 0; r < radius_buckets.size(); r++) {
+                        specialization data{a, radius_buckets[r]};
+                        vk::SpecializationInfo spec_info(entries.size(), entries.data(), sizeof(data), &data);
+                        vk::PipelineShaderStageCreateInfo shader({}, vk::ShaderStageFlagBits::eCompute, compShader.get(), "main", &spec_info);
+                        vk::ComputePipelineCreateInfo info({}, shader, pipelineLayout.get());
+                        pipelines[a][r] = device.createComputePipelineUnique(pipelineCache, info).value;
+                        dreamrender::debugName(device, pipelines[a][r].get(),
+                            "Blur Pipeline ("+std::string(a == 0 ? "horizontal" : "vertical")+", radius <= "+std::to_string(radius_buckets[r])+")");
+                    }
+                }
+            }
+        }
+
+        vk::DescriptorSetLayout get_descriptor_set_layout() const {
+            return descriptorSetLayout.get();
+        }
+
+        // Records the blur of the image bound to "descriptorSet" along one axis, barriers are up to the caller.
+        void dispatch(vk::CommandBuffer cmd, vk::DescriptorSet descriptorSet, axis dir, int radius, vk::Extent2D extent) const {
+            radius = std::clamp(radius, 0, radius_buckets.back());
+            auto bucket = std::ranges::find_if(radius_buckets, [radius](int r){ return radius <= r; });
+            auto index = std::distance(radius_buckets.begin(), bucket);
+
+            cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipelines[std::to_underlying(dir)][index].get());
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), 0, descriptorSet, {});
+
+            push_constants constants{radius};
+            cmd.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(push_constants), &constants);
+
+            unsigned int length = dir == axis::horizontal ? extent.width : extent.height;
+            unsigned int lines = dir == axis::horizontal ? extent.height : extent.width;
+            cmd.dispatch((length + tile_size - 1) / tile_size, lines, 1);
+        }
+    private:
+        struct push_constants {
+            int size;
+        };
+        struct specialization {
+            int axis;
+            int max_radius;
+        };
+
+        vk::Device device;
+        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+        vk::UniquePipelineLayout pipelineLayout;
+        std::array<std::array<vk::UniquePipeline, radius_buckets.size()>, 2> pipelines;
+};
+
+}
@@ -0,0 +1,60 @@
+#!/bin/bash
+# Creates the files of the worst-case benchmark scenarios (see "./build/xmbshell --benchmark list").
+# Usage: benchmarks/generate-workloads.sh [DIRECTORY] (default: build/benchmark-workloads)
+# Existing files are kept, so the script can be run again to fill in missing ones. Needs about 3 GB of disk space and ffmpeg.
+set -e
+
+out=${1:-build/benchmark-workloads}
+mkdir -p "$out"/{files,text,image,video,share/applications}
+
+# files_100k
+if [ ! -e "$out/files/file-099999.txt" ]; then
+    echo "Creating 100000 files in $out/files"
+    (cd "$out/files" && seq -f "file-%06g.txt" 0 99999 | xargs touch)
+fi
+
+# text_20k_lines, text_2g
+if [ ! -e "$out/text/lines-20k.txt" ]; then
+    seq -f "Line %g of 20000, long enough to be wrapped or clipped by the text viewer, depending on how it handles long lines" \
+        1 20000 > "$out/text/lines-20k.txt"
+fi
+if [ ! -e "$out/text/huge-2g.txt" ]; then
+    echo "Creating $out/text/huge-2g.txt"
+    yes "The quick brown fox jumps over the lazy dog. Two gigabytes of it, one line at a time." | head -c 2G > "$out/text/huge-2g.txt"
+fi
+
+# image_16k
+if [ ! -e "$out/image/16k.png" ]; then
+    ffmpeg -loglevel error -f lavfi -i testsrc2=size=16384x16384 -frames:v 1 "$out/image/16k.png"
+fi
+
+# video_4k, video_4k_10bit
+if [ ! -e "$out/video/4k-yuv420p.mkv" ]; then
+    ffmpeg -loglevel error -f lavfi -i testsrc2=size=3840x2160:rate=30 -t 30 \
+        -c:v libx264 -preset ultrafast -pix_fmt yuv420p "$out/video/4k-yuv420p.mkv"
+fi
+if [ ! -e "$out/video/4k-10bit.mkv" ]; then
+    ffmpeg -loglevel error -f lavfi -i testsrc2=size=3840x2160:rate=30 -t 30 \
+        -c:v libx264 -preset ultrafast -pix_fmt yuv420p10le "$out/video/4k-10bit.mkv"
+fi
+
+# applications_500
+if [ ! -e "$out/share/applications/xmbshell-benchmark-499.desktop" ]; then
+    for i in $(seq 0 499); do
+        categories="Utility;"
+        if [ $((i % 4)) -eq 0 ]; then
+            categories="Game;"
+        fi
+        cat > "$out/share/applications/xmbshell-benchmark-$i.desktop" <<DESKTOP
+[Desktop Entry]
+Type=Application
+Name=Benchmark Application $i
+Comment=Generated by benchmarks/generate-workloads.sh
+Exec=true
+Icon=applications-other
+Categories=$categories
+DESKTOP
+    done
+fi
+
+echo "Workloads are ready in $out"
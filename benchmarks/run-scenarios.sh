@@ -0,0 +1,28 @@
+#!/bin/bash
+# Runs every benchmark scenario and writes the results to build/benchmark-<scenario>.json.
+# Usage: benchmarks/run-scenarios.sh [SCENARIO...] (default: all of them)
+# The workloads have to be created with benchmarks/generate-workloads.sh first.
+set -e
+
+workloads=$(realpath build/benchmark-workloads)
+
+export GSETTINGS_SCHEMA_DIR="$PWD/schemas:$GSETTINGS_SCHEMA_DIR"
+export XMB_ASSET_DIR=.
+
+# A clean configuration (default settings), whose Photo directory is the one with 100k files
+# and whose applications include the 500 generated .desktop files.
+config=$(mktemp -d)
+trap 'rm -rf "$config"' EXIT
+echo "XDG_PICTURES_DIR=\"$workloads/files\"" > "$config/user-dirs.dirs"
+export XDG_CONFIG_HOME="$config"
+export XDG_DATA_DIRS="$workloads/share:${XDG_DATA_DIRS:-/usr/local/share:/usr/share}"
+
+scenarios=("$@")
+if [ ${#scenarios[@]} -eq 0 ]; then
+    mapfile -t scenarios < <(./build/xmbshell --benchmark list | grep -v '^\[' | cut -d: -f1)
+fi
+
+for scenario in "${scenarios[@]}"; do
+    dbus-launch ./build/xmbshell --benchmark "$scenario" --benchmark-workloads "$workloads" \
+        --benchmark-output "build/benchmark-$scenario.json"
+done
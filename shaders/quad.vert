@@ -0,0 +1,35 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#version 450
+
+// One instance per quad of a draw list batch (see src/render/components/quad_renderer.cppm).
+// Positions are in [0, 1] of the framebuffer, the quad is drawn as a triangle strip of four vertices.
+
+layout(location = 0) in vec4 inRect;  // x, y, width, height
+layout(location = 1) in vec4 inUV;    // u, v, width, height of the texture region
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 outUV;
+layout(location = 1) out vec4 outColor;
+
+void main() {
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 position = inRect.xy + corner * inRect.zw;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+    outUV = inUV.xy + corner * inUV.zw;
+    outColor = inColor;
+}
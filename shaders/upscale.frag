@@ -0,0 +1,52 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#version 450
+
+// Scales the image rendered at a lower resolution up to the framebuffer with bilinear filtering
+// and sharpens the result with a contrast adaptive sharpening filter (modelled after AMD FidelityFX CAS):
+// every pixel is pushed away from its four neighbours, less so where the neighbourhood already has a lot of contrast,
+// so edges get crisp again without ringing.
+
+layout(binding = 0) uniform sampler2D image;
+
+layout(push_constant) uniform PushConstants {
+    vec2 texel;      // size of a texel of "image" in uv coordinates
+    float sharpness; // 0 = only a little, 1 = as much as possible
+} constants;
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 center = texture(image, inUV);
+    vec3 e = center.rgb;
+    vec3 b = texture(image, inUV + vec2(0.0, -constants.texel.y)).rgb;
+    vec3 d = texture(image, inUV + vec2(-constants.texel.x, 0.0)).rgb;
+    vec3 f = texture(image, inUV + vec2(constants.texel.x, 0.0)).rgb;
+    vec3 h = texture(image, inUV + vec2(0.0, constants.texel.y)).rgb;
+
+    vec3 minimum = min(e, min(min(b, d), min(f, h)));
+    vec3 maximum = max(e, max(max(b, d), max(f, h)));
+
+    // how far the neighbourhood is from clipping, relative to its brightness
+    vec3 amount = sqrt(clamp(min(minimum, 1.0 - maximum) / max(maximum, vec3(1.0/65536.0)), 0.0, 1.0));
+    vec3 weight = amount * (-1.0 / mix(8.0, 5.0, constants.sharpness));
+
+    vec3 color = (e + (b + d + f + h) * weight) / (1.0 + 4.0 * weight);
+    outColor = vec4(clamp(color, 0.0, 1.0), center.a);
+}
@@ -0,0 +1,421 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef XMBSHELL_COUNT_ALLOCATIONS
+// see benchmarks/allocation_counter.cpp
+namespace allocation_counter {
+    std::uint64_t count();
+}
+#endif
+
+module xmbshell.app;
+import :benchmark;
+import :choice_overlay;
+import :menu_base;
+import :message_overlay;
+import :programs;
+
+import giomm;
+import i18n;
+import spdlog;
+import sdl2;
+import vma;
+
+namespace app {
+    using namespace mfk::i18n::literals;
+
+namespace {
+    // The same sequence as test/headless.sh, one key every 30 frames.
+    std::vector<input_script::step> navigation_steps(unsigned int first_frame) {
+        constexpr std::array keys = {
+            SDLK_DOWN, SDLK_UP, SDLK_RIGHT, SDLK_DOWN, SDLK_RETURN, SDLK_DOWN, SDLK_RETURN, SDLK_DOWN, SDLK_UP,
+            SDLK_ESCAPE, SDLK_ESCAPE, SDLK_DOWN, SDLK_RETURN, SDLK_RETURN, SDLK_ESCAPE, SDLK_ESCAPE,
+            SDLK_LEFT, SDLK_DOWN, SDLK_RETURN, SDLK_RIGHT, SDLK_RETURN,
+        };
+        std::vector<input_script::step> steps;
+        for(unsigned int i = 0; i < keys.size(); i++) {
+            steps.push_back(input_script::press(first_frame + 30*i, keys[i]));
+        }
+        return steps;
+    }
+
+    std::vector<input_script::step> blur_toggle_steps(unsigned int first_frame, unsigned int count) {
+        std::vector<input_script::step> steps;
+        for(unsigned int i = 0; i < count; i++) {
+            steps.push_back(input_script::toggle_blur(first_frame + 60*i));
+        }
+        return steps;
+    }
+
+    // One press of "key" every "interval" frames, e.g. to scroll through a list.
+    std::vector<input_script::step> repeat_steps(unsigned int first_frame, unsigned int count, unsigned int interval, int32_t key) {
+        std::vector<input_script::step> steps;
+        for(unsigned int i = 0; i < count; i++) {
+            steps.push_back(input_script::press(first_frame + interval*i, key));
+        }
+        return steps;
+    }
+
+    std::vector<input_script::step> concat(std::vector<input_script::step> a, const std::vector<input_script::step>& b) {
+        a.insert(a.end(), b.begin(), b.end());
+        return a;
+    }
+
+    std::vector<input_script::step> overlay_stack_steps(unsigned int frame, unsigned int depth) {
+        return {{frame, [depth](xmbshell* xmb) {
+            for(unsigned int i = 0; i < depth; i++) {
+                if(i % 2 == 0) {
+                    xmb->emplace_overlay<message_overlay>(std::format("Overlay {}", i), "A message in a deep stack of overlays",
+                        std::vector<std::string>{"OK", "Cancel"});
+                } else {
+                    xmb->emplace_overlay<choice_overlay>(std::vector<std::string>{"First", "Second", "Third", "Fourth"});
+                }
+            }
+        }}};
+    }
+
+    struct percentiles {
+        double mean, p50, p95, p99, max;
+    };
+    percentiles get_percentiles(std::vector<double> values) {
+        if(values.empty()) {
+            return {};
+        }
+        std::ranges::sort(values);
+        auto p = [&](double q) { return values[static_cast<std::size_t>(q * static_cast<double>(values.size() - 1))]; };
+        double mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+        return {mean, p(0.50), p(0.95), p(0.99), values.back()};
+    }
+    std::string to_json(const percentiles& p) {
+        return std::format(R"({{"mean": {:.4f}, "p50": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, "max": {:.4f}}})",
+            p.mean, p.p50, p.p95, p.p99, p.max);
+    }
+    std::string quote(std::string_view str) {
+        std::string result = "\"";
+        for(char c : str) {
+            if(c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result + "\"";
+    }
+
+    // Current and peak resident set size in KiB, read from /proc/self/status.
+    std::pair<uint64_t, uint64_t> get_rss() {
+        uint64_t current = 0, peak = 0;
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while(std::getline(status, line)) {
+            auto value = [&]() -> uint64_t {
+                auto digits = line.substr(line.find(':')+1);
+                try {
+                    return std::stoull(digits);
+                } catch(...) {
+                    return 0;
+                }
+            };
+            if(line.starts_with("VmRSS:")) {
+                current = value();
+            } else if(line.starts_with("VmHWM:")) {
+                peak = value();
+            }
+        }
+        return {current, peak};
+    }
+}
+
+std::span<const benchmark::scenario> benchmark::get_scenarios() {
+    static const std::vector<scenario> scenarios = [](){
+        std::vector<scenario> s;
+        s.push_back({"idle", "Main menu without any input", 60, 600, {}});
+        s.back().allocation_free = true;
+        s.push_back({"navigate", "The input sequence of test/headless.sh", 60, 720, navigation_steps(60)});
+        s.push_back({"blur", "Toggles the background blur every second", 60, 600, blur_toggle_steps(60, 10)});
+
+        // Worst cases, the workloads are created by benchmarks/generate-workloads.sh.
+        // The menu columns use the directories of the environment that benchmarks/run-scenarios.sh sets up.
+        auto select_column_step = [](unsigned int frame, std::string (*name)()) {
+            // the names are translated like in main_menu, but only once the scenario runs
+            return std::vector<input_script::step>{{frame, [name](xmbshell* xmb) { select_column(xmb, name()); }}};
+        };
+        s.push_back({"files_100k", "Opens a Photo directory with 100k files and scrolls through it", 60, 600,
+            concat(select_column_step(60, []() -> std::string { return "Photo"_(); }), repeat_steps(90, 80, 6, SDLK_DOWN)),
+            "files", false, &benchmark::is_column_loaded});
+        s.push_back({"applications_500", "Shows the Application column with 500 .desktop files and scrolls through it", 60, 600,
+            concat(select_column_step(60, []() -> std::string { return "Application"_(); }), repeat_steps(90, 80, 6, SDLK_DOWN)),
+            "share/applications", false, &benchmark::is_column_loaded});
+        s.push_back({"text_20k_lines", "Opens a text file with 20k lines and scrolls through it", 60, 600,
+            repeat_steps(90, 80, 6, SDLK_DOWN), "text/lines-20k.txt", true, &benchmark::is_program_loaded});
+        s.push_back({"text_2g", "Opens a 2 GB text file and scrolls through it", 60, 600,
+            repeat_steps(90, 80, 6, SDLK_DOWN), "text/huge-2g.txt", true, &benchmark::is_program_loaded});
+        s.push_back({"image_16k", "Opens a 16384x16384 PNG and zooms into it", 60, 600,
+            repeat_steps(90, 40, 12, SDLK_UP), "image/16k.png", true, &benchmark::is_program_loaded});
+        s.push_back({"video_4k", "Plays a 4K YUV420P clip", 60, 600,
+            {}, "video/4k-yuv420p.mkv", true, &benchmark::is_program_loaded});
+        s.push_back({"video_4k_10bit", "Plays a 4K 10-bit clip", 60, 600,
+            {}, "video/4k-10bit.mkv", true, &benchmark::is_program_loaded});
+        s.push_back({"overlay_stack", "Shows a stack of 64 message and choice overlays", 60, 600, overlay_stack_steps(60, 64)});
+        return s;
+    }();
+    return scenarios;
+}
+
+const benchmark::scenario* benchmark::find_scenario(std::string_view name) {
+    auto scenarios = get_scenarios();
+    auto it = std::ranges::find(scenarios, name, &scenario::name);
+    return it == scenarios.end() ? nullptr : &*it;
+}
+
+benchmark::benchmark(const scenario& s, std::filesystem::path output, std::filesystem::path workloads)
+    : current(s), output(std::move(output)), workloads(std::move(workloads)), script(s.steps)
+{
+    spdlog::info("Running benchmark scenario \"{}\" ({} + {} frames)", current.name, current.warmup_frames, current.frames);
+    // before the first frame, so a missing workload is reported by the first frame() instead of in the middle of the scenario
+    try {
+        resolve_workload();
+    } catch(const std::exception& e) {
+        spdlog::error("Scenario \"{}\" cannot run: {}", current.name, e.what());
+        failed = true;
+    }
+}
+
+void benchmark::resolve_workload() {
+    if(current.workload.empty()) {
+        return;
+    }
+    auto path = workloads / current.workload;
+    if(!std::filesystem::exists(path)) {
+        throw std::runtime_error("Benchmark workload "+path.string()+" does not exist, create it with benchmarks/generate-workloads.sh");
+    }
+    if(std::filesystem::is_directory(path)) {
+        workload_entries = std::ranges::distance(std::filesystem::directory_iterator(path), std::filesystem::directory_iterator{});
+    }
+    if(current.open_workload) {
+        auto info = Gio::File::create_for_path(path.string())->query_info("standard::fast-content-type");
+        auto open_infos = programs::get_open_infos(path, *info.get());
+        if(open_infos.empty()) {
+            throw std::runtime_error("No program found for benchmark workload "+path.string());
+        }
+        workload_program = open_infos.front();
+    }
+}
+
+bool benchmark::frame(xmbshell* xmb) {
+    if(failed) {
+        abort(xmb, "the scenario could not be prepared");
+        return false;
+    }
+    try {
+        return step(xmb);
+    } catch(const std::exception& e) {
+        abort(xmb, e.what());
+        return false;
+    }
+}
+
+void benchmark::abort(xmbshell* xmb, std::string_view reason) {
+    spdlog::error("Scenario \"{}\" failed at frame {}: {}", current.name, script.get_frame(), reason);
+    failed = true;
+    input_script::quit(script.get_frame()).action(xmb);
+}
+
+bool benchmark::step(xmbshell* xmb) {
+    count_allocations();
+    unsigned int frame_number = script.get_frame();
+    auto now = std::chrono::steady_clock::now();
+    if(!first_frame) {
+        first_frame = now;
+    }
+    if(frame_number == current.warmup_frames) {
+        start = now;
+        if(current.open_workload) {
+            open_workload(xmb);
+        }
+    } else if(frame_number > current.warmup_frames && !interactive) {
+        if(!current.ready || current.ready(*this, xmb)) {
+            interactive = now;
+            interactive_frame = frame_number;
+            spdlog::info("Scenario \"{}\" is interactive after {:.1f} ms", current.name,
+                std::chrono::duration<double, std::milli>(now - start).count());
+        }
+    } else if(interactive) {
+        sample(xmb);
+    }
+    last_frame = std::chrono::steady_clock::now();
+
+    if(frame_number >= current.warmup_frames + current.frames) {
+        if(current.allocation_free && allocating_frames > 0) {
+            spdlog::error("Scenario \"{}\" allocated from the heap {} times in {} steady-state frames",
+                current.name, heap_allocations, allocating_frames);
+            failed = true;
+        }
+        write_report(xmb);
+        input_script::quit(frame_number).action(xmb);
+        return false;
+    }
+
+    script.frame(xmb);
+    mark_allocations();
+    return true;
+}
+
+void benchmark::count_allocations() {
+#ifdef XMBSHELL_COUNT_ALLOCATIONS
+    if(!interactive) {
+        return;
+    }
+    if(auto count = allocation_counter::count() - allocations_mark; count > 0) {
+        heap_allocations += count;
+        allocating_frames++;
+    }
+#endif
+}
+
+void benchmark::mark_allocations() {
+#ifdef XMBSHELL_COUNT_ALLOCATIONS
+    allocations_mark = allocation_counter::count();
+#endif
+}
+
+void benchmark::open_workload(xmbshell* xmb) {
+    program = xmb->push_overlay(workload_program->create(workloads / current.workload, *xmb->loader));
+}
+
+void benchmark::select_column(xmbshell* xmb, const std::string& name) {
+    const auto& menus = xmb->menu.menus;
+    auto it = std::ranges::find_if(menus, [&](const auto& m) { return m->get_name() == name; });
+    if(it == menus.end()) {
+        throw std::runtime_error("The main menu has no column called \""+name+"\"");
+    }
+    xmb->menu.select(static_cast<int>(std::distance(menus.begin(), it)));
+}
+
+bool benchmark::is_program_loaded(xmbshell* xmb) const {
+    const bool open = std::ranges::any_of(xmb->overlays, [this](const auto& o) { return o.get() == program; });
+    return open && program->is_loaded();
+}
+
+bool benchmark::is_column_loaded(xmbshell* xmb) const {
+    const auto& column = *xmb->menu.menus[xmb->menu.selected];
+    // an async menu only shows a placeholder until its provider is done
+    if(auto* m = dynamic_cast<const ::menu::async_menu*>(&column); m && m->is_loading()) {
+        return false;
+    }
+    return column.get_submenus_count() >= workload_entries;
+}
+
+void benchmark::sample(xmbshell* xmb) {
+    auto now = std::chrono::steady_clock::now();
+    frame_times.push_back(std::chrono::duration<double, std::milli>(now - *last_frame).count());
+
+    for(const auto& phase : xmb->profiler.get_phases()) {
+        if(phase.last_sample) {
+            auto it = phase_times.find(phase.name);
+            if(it == phase_times.end()) {
+                it = phase_times.emplace(phase.name, std::vector<double>{}).first;
+            }
+            it->second.push_back(*phase.last_sample);
+        }
+    }
+
+    uint64_t usage = 0;
+    uint32_t allocations = 0;
+    for(const auto& b : xmb->allocator.getHeapBudgets()) {
+        usage += b.usage;
+        allocations += b.statistics.allocationCount;
+    }
+    peak_vram = std::max(peak_vram, usage);
+    peak_allocations = std::max(peak_allocations, allocations);
+}
+
+void benchmark::write_report(xmbshell* xmb) const {
+    // the statistics only cover the steady state after the scenario became interactive
+    auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - interactive.value_or(start)).count();
+    if(!interactive) {
+        spdlog::warn("Scenario \"{}\" did not become interactive within {} frames", current.name, current.frames);
+    }
+    auto [rss, peak_rss] = get_rss();
+
+    uint64_t usage = 0, budget = 0;
+    uint32_t allocations = 0;
+    for(const auto& b : xmb->allocator.getHeapBudgets()) {
+        usage += b.usage;
+        budget += b.budget;
+        allocations += b.statistics.allocationCount;
+    }
+
+    std::string cpu_phases;
+    for(const auto& [name, times] : phase_times) {
+        cpu_phases += std::format("{}    {}: {}", cpu_phases.empty() ? "" : ",\n", quote(name), to_json(get_percentiles(times)));
+    }
+    std::string gpu_passes;
+    for(const auto& r : xmb->gpu_timer->get_results()) {
+        gpu_passes += std::format("{}    {}: {:.4f}", gpu_passes.empty() ? "" : ",\n", quote(r.name), r.milliseconds);
+    }
+
+    auto milliseconds = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    std::string time_to_interactive = interactive ? std::format("{:.4f}", milliseconds(*interactive - start)) : "null";
+#ifdef XMBSHELL_COUNT_ALLOCATIONS
+    std::string heap = std::format(R"({{"total": {}, "frames": {}}})", heap_allocations, allocating_frames);
+#else
+    std::string heap = "null";
+#endif
+
+    std::ofstream out(output);
+    out << "{\n";
+    out << std::format("  \"scenario\": {},\n", quote(current.name));
+    out << std::format("  \"startup_ms\": {:.4f},\n", milliseconds(*first_frame - created));
+    out << std::format("  \"time_to_interactive_ms\": {},\n", time_to_interactive);
+    out << std::format("  \"time_to_interactive_frames\": {},\n", interactive ? interactive_frame - current.warmup_frames : 0);
+    out << std::format("  \"frames\": {},\n", frame_times.size());
+    out << std::format("  \"duration_s\": {:.4f},\n", duration);
+    out << std::format("  \"frame_time_ms\": {},\n", to_json(get_percentiles(frame_times)));
+    out << std::format("  \"cpu_phases_ms\": {{\n{}\n  }},\n", cpu_phases);
+    out << std::format("  \"gpu_passes_ms\": {{\n{}\n  }},\n", gpu_passes);
+    out << std::format("  \"vram_bytes\": {{\"peak\": {}, \"current\": {}, \"budget\": {}}},\n", peak_vram, usage, budget);
+    out << std::format("  \"rss_kib\": {{\"peak\": {}, \"current\": {}}},\n", peak_rss, rss);
+    out << std::format("  \"gpu_allocations\": {{\"peak\": {}, \"current\": {}}},\n", peak_allocations, allocations);
+    out << std::format("  \"heap_allocations\": {}\n", heap);
+    out << "}\n";
+
+    if(!out) {
+        spdlog::error("Failed to write benchmark results to {}", output.string());
+        return;
+    }
+    spdlog::info("Benchmark results written to {}", output.string());
+}
+
+}
@@ -0,0 +1,117 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+export module xmbshell.app:benchmark;
+
+import :component;
+import :frame_profiler;
+import :input_script;
+import :programs;
+
+namespace app {
+
+class xmbshell;
+
+/* Runs a scripted scenario for a fixed number of frames and writes statistics about it as JSON.
+ * The input of a scenario is keyed to frame numbers, so every run sees the same sequence of events.
+ * The measurement starts at the first frame after the warmup: the time until the scenario becomes ready is
+ * reported as time to interactive, the frames after that as steady state.
+ * Scenarios with a workload need the files created by benchmarks/generate-workloads.sh.
+ * A scenario that cannot run (e.g. a missing workload or column) stops and counts as failed.
+ */
+export class benchmark {
+    public:
+        struct scenario {
+            std::string_view name;
+            std::string_view description;
+            unsigned int warmup_frames; // not included in the statistics (loading, first transitions...)
+            unsigned int frames;
+            std::vector<input_script::step> steps;
+            std::filesystem::path workload = {}; // relative to the workload directory
+            bool open_workload = false; // with its program, at the first frame after the warmup
+            std::function<bool(const benchmark&, xmbshell*)> ready = {}; // if empty, the scenario is ready one frame after the warmup
+            bool allocation_free = false; // fails if a steady-state frame allocates from the heap (only checked with COUNT_ALLOCATIONS)
+        };
+
+        static std::span<const scenario> get_scenarios();
+        static const scenario* find_scenario(std::string_view name);
+
+        benchmark(const scenario& s, std::filesystem::path output, std::filesystem::path workloads);
+
+        // Called at the beginning of every frame, runs the steps of the current frame. Returns false once the scenario is done.
+        bool frame(xmbshell* xmb);
+        bool has_failed() const {
+            return failed;
+        }
+    private:
+        // Throws if the workload is missing or there is no program to open it with.
+        void resolve_workload();
+        bool step(xmbshell* xmb);
+        // Stops the scenario early, it counts as failed.
+        void abort(xmbshell* xmb, std::string_view reason);
+
+        // Counts what the render thread allocated since the end of the last frame() call, i.e. in the last frame.
+        void count_allocations();
+        void mark_allocations();
+        void sample(xmbshell* xmb);
+        void write_report(xmbshell* xmb) const;
+
+        void open_workload(xmbshell* xmb);
+        // Selects the column called "name", so scenarios do not depend on the order of the columns.
+        static void select_column(xmbshell* xmb, const std::string& name);
+
+        bool is_program_loaded(xmbshell* xmb) const;
+        // Whether the selected column shows at least as many entries as the workload directory has files.
+        bool is_column_loaded(xmbshell* xmb) const;
+
+        const scenario& current;
+        std::filesystem::path output;
+        std::filesystem::path workloads;
+        input_script script;
+        std::size_t workload_entries = 0; // if the workload is a directory
+        std::optional<programs::open_info> workload_program; // if the scenario opens the workload
+        const component* program = nullptr; // opened with the workload
+
+        std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+        std::optional<std::chrono::steady_clock::time_point> last_frame;
+        std::optional<std::chrono::steady_clock::time_point> first_frame;
+        std::chrono::steady_clock::time_point start;
+        std::optional<std::chrono::steady_clock::time_point> interactive;
+        unsigned int interactive_frame = 0;
+        std::vector<double> frame_times;
+        std::map<std::string, std::vector<double>, std::less<>> phase_times;
+        uint64_t peak_vram = 0;
+        uint32_t peak_allocations = 0;
+        uint64_t allocations_mark = 0;
+        uint64_t heap_allocations = 0;
+        unsigned int allocating_frames = 0;
+        bool failed = false;
+};
+
+}
@@ -23,10 +23,14 @@ module;
 module xmbshell.app;
 
 import dreamrender;
+import glm;
 import :component;
 
 namespace app {
     void component::render_controller_buttons(app::xmbshell* xmb, dreamrender::gui_renderer& renderer, float x, float y, std::span<const std::pair<action, std::string_view>> buttons) const {
         xmb->render_controller_buttons(renderer, x, y, buttons);
     }
+    glm::vec2 component::measure_text(app::xmbshell* xmb, dreamrender::gui_renderer& renderer, std::string_view text, float size) const {
+        return xmb->measure_text(renderer, text, size);
+    }
 }
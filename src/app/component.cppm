@@ -23,6 +23,7 @@ module;
 export module xmbshell.app:component;
 
 import dreamrender;
+import glm;
 import xmbshell.utils;
 import vulkan_hpp;
 
@@ -40,8 +41,13 @@ export class component {
         [[nodiscard]] virtual bool do_fade_in() const { return false; }
         [[nodiscard]] virtual bool do_fade_out() const { return false; }
         [[nodiscard]] virtual bool enable_cursor() const { return false; }
+        // Whether the component changes its appearance on its own, i.e. without any input.
+        [[nodiscard]] virtual bool is_animated() const { return false; }
+        // Whether the component has loaded everything it shows (e.g. a program the file it opened).
+        [[nodiscard]] virtual bool is_loaded() const { return true; }
     protected:
         void render_controller_buttons(app::xmbshell* xmb, dreamrender::gui_renderer& renderer, float x, float y, std::span<const std::pair<action, std::string_view>> buttons) const;
+        glm::vec2 measure_text(app::xmbshell* xmb, dreamrender::gui_renderer& renderer, std::string_view text, float size) const;
 };
 
 }
@@ -29,6 +29,7 @@ import dreamrender;
 import glm;
 import vulkan_hpp;
 import vma;
+import xmbshell.utils;
 
 namespace app {
 
@@ -70,14 +71,14 @@ bool choice_overlay::select_relative(action dir) {
             return false;
         }
         last_selection_index = selection_index;
-        last_selection_time = std::chrono::system_clock::now();
+        last_selection_time = utils::clock::now();
         selection_index = (selection_index + choices.size() - 1) % choices.size();
     } else if(dir == action::down) {
         if(selection_index >= choices.size() - 1) {
             return false;
         }
         last_selection_index = selection_index;
-        last_selection_time = std::chrono::system_clock::now();
+        last_selection_time = utils::clock::now();
         selection_index = (selection_index + 1) % choices.size();
     } else {
         return false;
@@ -100,7 +101,7 @@ void choice_overlay::render(dreamrender::gui_renderer& renderer, class xmbshell*
         }
     });
 
-    auto now = std::chrono::system_clock::now();
+    auto now = utils::clock::now();
     double selected = selection_index;
     auto time_since_transition = std::chrono::duration<double>(now - last_selection_time);
     if(time_since_transition < transition_duration) {
@@ -45,6 +45,9 @@ export class choice_overlay : public component, public action_receiver {
         [[nodiscard]] bool is_opaque() const override { return false; }
         [[nodiscard]] bool do_fade_in() const override { return true; }
         [[nodiscard]] bool do_fade_out() const override { return true; }
+        [[nodiscard]] bool is_animated() const override {
+            return utils::clock::now() - last_selection_time < transition_duration;
+        }
     private:
         using time_point = std::chrono::time_point<std::chrono::system_clock>;
 
@@ -56,7 +59,7 @@ export class choice_overlay : public component, public action_receiver {
 
         unsigned int selection_index = 0;
         unsigned int last_selection_index = 0;
-        time_point last_selection_time = std::chrono::system_clock::now();
+        time_point last_selection_time = utils::clock::now();
 
         constexpr static auto transition_duration = std::chrono::milliseconds(100);
 };
@@ -17,6 +17,9 @@
 module;
 
 #include <chrono>
+#include <memory_resource>
+#include <string>
+#include <vector>
 
 module xmbshell.app;
 
@@ -29,6 +32,7 @@ import vma;
 import dreamrender;
 
 import xmbshell.config;
+import xmbshell.render;
 import :menu_base;
 import :menu_utils;
 import :applications_menu;
@@ -63,9 +67,31 @@ void main_menu::preload(vk::Device device, vma::Allocator allocator, dreamrender
     menus.push_back(make_simple_of<menu::menu>("Network"_(), asset_directory/"icons/icon_category_network.png", loader));
     menus.push_back(make_simple_of<menu::menu>("Friends"_(), asset_directory/"icons/icon_category_friends.png", loader));
 
+    for(auto& m : menus) {
+        m->on_entries_changed([this, m = m.get()](unsigned int, unsigned int count) {
+            if(m->get_selected_submenu() >= count) {
+                m->select_submenu(count > 0 ? count-1 : 0);
+            }
+            if(m == menus[selected].get()) {
+                // no transition from an entry that does not exist anymore
+                last_selected_menu_item = m->get_selected_submenu();
+            }
+            shell->mark_dirty(dirty_tracker::reason::content);
+        });
+    }
     menus[selected]->on_open();
 }
 
+void main_menu::tick() {
+    for(auto& m : menus) {
+        m->poll();
+        if(m->is_loading()) {
+            // the entries only appear once poll() takes them over
+            shell->stay_awake();
+        }
+    }
+}
+
 result main_menu::on_action(action action) {
     switch(action) {
         case action::left:
@@ -146,7 +172,7 @@ bool main_menu::activate_current(action action) {
 
                 if(!in_submenu) {
                     in_submenu = true;
-                    last_submenu_transition = std::chrono::system_clock::now();
+                    last_submenu_transition = utils::clock::now();
                 }
                 return true;
             }
@@ -161,7 +187,7 @@ bool main_menu::back() {
         if(submenu_stack.empty()) {
             current_submenu = nullptr;
             in_submenu = false;
-            last_submenu_transition = std::chrono::system_clock::now();
+            last_submenu_transition = utils::clock::now();
         } else {
             current_submenu = submenu_stack.back();
             submenu_stack.pop_back();
@@ -180,7 +206,7 @@ void main_menu::select(int index) {
     }
 
     last_selected = selected;
-    last_selected_transition = std::chrono::system_clock::now();
+    last_selected_transition = utils::clock::now();
     selected = index;
 
     menus[last_selected]->on_close();
@@ -198,7 +224,7 @@ void main_menu::select_menu_item(int index) {
     }
 
     last_selected_menu_item = menu->get_selected_submenu();
-    last_selected_menu_item_transition = std::chrono::system_clock::now();
+    last_selected_menu_item_transition = utils::clock::now();
     menu->select_submenu(index);
 }
 void main_menu::select_submenu_item(int index) {
@@ -211,36 +237,66 @@ void main_menu::select_submenu_item(int index) {
     }
 
     last_selected_submenu_item = menu->get_selected_submenu();
-    last_selected_submenu_item_transition = std::chrono::system_clock::now();
+    last_selected_submenu_item_transition = utils::clock::now();
     menu->select_submenu(index);
 }
 
+bool main_menu::is_animating(time_point now) const {
+    return now - last_selected_transition < transition_duration ||
+        now - last_selected_menu_item_transition < transition_menu_item_duration ||
+        now - last_submenu_transition < transition_submenu_activate_duration ||
+        now - last_selected_submenu_item_transition < transition_submenu_item_duration;
+}
+
+void main_menu::draw_icon(render::draw_list& renderer, const menu::menu_entry& entry, float x, float y, float w, float h) {
+    if(auto* icon = entry.get_atlas_icon()) {
+        if(!icon->is_loaded()) {
+            shell->mark_dirty(dirty_tracker::reason::content);
+        }
+        renderer.draw_image_a(*icon, x, y, w, h);
+        return;
+    }
+    const dreamrender::texture& icon = entry.get_icon();
+    if(!icon.loaded) {
+        // the icon will appear as soon as the loader is done with it
+        shell->mark_dirty(dirty_tracker::reason::content);
+    }
+    renderer.draw_image_a(icon, x, y, w, h);
+}
+
 void main_menu::render(dreamrender::gui_renderer& renderer) {
     constexpr glm::vec4 active_color(1.0f, 1.0f, 1.0f, 1.0f);
     constexpr glm::vec4 inactive_color(0.25f, 0.25f, 0.25f, 0.25f);
 
-    auto now = std::chrono::system_clock::now();
+    auto now = utils::clock::now();
+    if(is_animating(now)) {
+        shell->mark_dirty(dirty_tracker::reason::animation);
+    }
 
     auto time_since_transition = std::chrono::duration<double>(now - last_submenu_transition);
     double partial = std::clamp(time_since_transition / transition_submenu_activate_duration, 0.0, 1.0);
     partial = in_submenu ? partial : 1.0 - partial;
     bool in_submenu_now = in_submenu || partial > 0.0;
 
-    renderer.push_color(glm::mix(active_color, inactive_color, partial));
-    render_crossbar(renderer, now);
-    renderer.pop_color();
-
-    std::vector<std::pair<action, std::string>> buttons{};
+    std::pmr::vector<std::pair<action, std::pmr::string>> buttons(shell->get_frame_arena().get());
     buttons.reserve(5);
     menus[selected]->get_button_actions(buttons);
-    if(in_submenu_now && current_submenu) {
-        render_submenu(renderer, now);
-        current_submenu->get_button_actions(buttons);
+    {
+        // hundreds of icons can be visible, so they are batched instead of being drawn one by one
+        auto list = shell->make_draw_list(renderer);
+        list.push_color(glm::mix(active_color, inactive_color, partial));
+        render_crossbar(list, now);
+        list.pop_color();
+
+        if(in_submenu_now && current_submenu) {
+            render_submenu(list, now);
+            current_submenu->get_button_actions(buttons);
+        }
     }
     shell->render_controller_buttons(renderer, 0.5f, 0.9f, buttons);
 }
 
-void main_menu::render_crossbar(dreamrender::gui_renderer& renderer, time_point now) {
+void main_menu::render_crossbar(render::draw_list& renderer, time_point now) {
     double submenu_transition = std::clamp(
         std::chrono::duration<double>(now - last_submenu_transition) / transition_submenu_activate_duration, 0.0, 1.0);
     submenu_transition = in_submenu ? submenu_transition : 1.0 - submenu_transition;
@@ -279,7 +335,7 @@ void main_menu::render_crossbar(dreamrender::gui_renderer& renderer, time_point
         }
 
         auto& menu = menus[i];
-        renderer.draw_image_a(menu->get_icon(), x, base_pos.y, base_size, base_size);
+        draw_icon(renderer, *menu, x, base_pos.y, base_size, base_size);
         if(i == selected) {
             renderer.draw_text(menu->get_name(), x+(base_size*0.5f)/renderer.aspect_ratio, base_pos.y+base_size, base_size*0.4f, glm::vec4(1, 1, 1, 1), true);
         }
@@ -314,7 +370,7 @@ void main_menu::render_crossbar(dreamrender::gui_renderer& renderer, time_point
         }
         for(int i=selected_submenu-1; i >= 0 && y >= -base_size*0.65f; i--) {
             auto& submenu = menu->get_submenu(i);
-            renderer.draw_image_a(submenu.get_icon(), x+(base_size*0.2f)/renderer.aspect_ratio, y, base_size*0.6f, base_size*0.6f);
+            draw_icon(renderer, submenu, x+(base_size*0.2f)/renderer.aspect_ratio, y, base_size*0.6f, base_size*0.6f);
             if(!in_submenu_now)
                 renderer.draw_text(submenu.get_name(), x+(base_size*1.5f)/renderer.aspect_ratio, y+(base_size*0.3f), base_size*0.4f, glm::vec4(0.7, 0.7, 0.7, 1), false, true);
             y -= base_size*0.65f;
@@ -333,7 +389,7 @@ void main_menu::render_crossbar(dreamrender::gui_renderer& renderer, time_point
                 if(!in_submenu_now) {
                     double size = base_size*glm::mix(0.6, 1.2, partial_transition);
                 double text_size = base_size*glm::mix(0.4, 0.6, partial_transition);
-                    renderer.draw_image_a(submenu.get_icon(), x+(base_size*0.5f-size/2.0f)/renderer.aspect_ratio, y, size, size);
+                    draw_icon(renderer, submenu, x+(base_size*0.5f-size/2.0f)/renderer.aspect_ratio, y, size, size);
                     if(!in_submenu_now)
                         renderer.draw_text(submenu.get_name(), x+(base_size*1.5f)/renderer.aspect_ratio, y+size/2, text_size, glm::vec4(1, 1, 1, 1), false, true);
                 }
@@ -342,13 +398,13 @@ void main_menu::render_crossbar(dreamrender::gui_renderer& renderer, time_point
             else if(i == last_selected_menu_item) {
                 double size = base_size*glm::mix(0.6, 1.2, 1.0f-partial_transition);
                 double text_size = base_size*glm::mix(0.4, 0.6, 1.0f-partial_transition);
-                renderer.draw_image_a(submenu.get_icon(), x+(0.05f-size/2.0f)/renderer.aspect_ratio, y, size, size);
+                draw_icon(renderer, submenu, x+(0.05f-size/2.0f)/renderer.aspect_ratio, y, size, size);
                 if(!in_submenu_now)
                     renderer.draw_text(submenu.get_name(), x+(base_size*1.5f)/renderer.aspect_ratio, y+size/2, text_size, glm::vec4(1, 1, 1, 1), false, true);
                 y += base_size*glm::mix(0.65f, 1.5f, 1.0f-partial_transition);
             }
             else {
-                renderer.draw_image_a(submenu.get_icon(), x+(base_size*0.2f)/renderer.aspect_ratio, y, base_size*0.6f, base_size*0.6f);
+                draw_icon(renderer, submenu, x+(base_size*0.2f)/renderer.aspect_ratio, y, base_size*0.6f, base_size*0.6f);
                 if(!in_submenu_now)
                     renderer.draw_text(submenu.get_name(), x+(base_size*1.5f)/renderer.aspect_ratio, y+base_size*0.3f, base_size*0.4f, glm::vec4(0.7, 0.7, 0.7, 1), false, true);
                 y += base_size*0.65f;
@@ -357,7 +413,7 @@ void main_menu::render_crossbar(dreamrender::gui_renderer& renderer, time_point
     }
 }
 
-void main_menu::render_submenu(dreamrender::gui_renderer& renderer, time_point now) {
+void main_menu::render_submenu(render::draw_list& renderer, time_point now) {
     double submenu_transition = std::clamp(
         std::chrono::duration<double>(now - last_submenu_transition) / transition_submenu_activate_duration, 0.0, 1.0);
     submenu_transition = in_submenu ? submenu_transition : 1.0 - submenu_transition;
@@ -372,8 +428,8 @@ void main_menu::render_submenu(dreamrender::gui_renderer& renderer, time_point n
     const auto& selected_menu = *menus[selected];
     const auto& selected_submenu = *current_submenu;
 
-    renderer.draw_image_a(selected_menu.get_icon(), base_pos.x, base_pos.y, 0.1f, 0.1f);
-    renderer.draw_image_a(selected_submenu.get_icon(), base_pos.x, base_pos.y+0.15f, 0.1f, 0.1f);
+    draw_icon(renderer, selected_menu, base_pos.x, base_pos.y, 0.1f, 0.1f);
+    draw_icon(renderer, selected_submenu, base_pos.x, base_pos.y+0.15f, 0.1f, 0.1f);
 
     if(!in_submenu)
         return;
@@ -401,7 +457,7 @@ void main_menu::render_submenu(dreamrender::gui_renderer& renderer, time_point n
                 continue;
 
             auto& entry = submenu->get_submenu(i);
-            renderer.draw_image_a(entry.get_icon(), base_pos.x + 0.1 + offset, y, size, size);
+            draw_icon(renderer, entry, base_pos.x + 0.1 + offset, y, size, size);
             renderer.draw_text(entry.get_name(), base_pos.x + 0.2, y+size/2, size/2, glm::vec4(1, 1, 1, 1), false, true);
             if(i == selected) {
                 auto s = renderer.measure_text(entry.get_name(), size/2);
@@ -27,6 +27,7 @@ import dreamrender;
 import sdl2;
 import vulkan_hpp;
 import vma;
+import xmbshell.render;
 import xmbshell.utils;
 
 namespace app {
@@ -35,16 +36,22 @@ class main_menu : public action_receiver {
     public:
         main_menu(class xmbshell* shell);
         void preload(vk::Device device, vma::Allocator allocator, dreamrender::resource_loader& loader);
+        // Takes over the entries of categories that finished loading in the background.
+        void tick();
         void render(dreamrender::gui_renderer& renderer);
 
         result on_action(action action) override;
     private:
+        friend class benchmark;
+
         using time_point = std::chrono::time_point<std::chrono::system_clock>;
 
         class xmbshell* shell;
 
-        void render_crossbar(dreamrender::gui_renderer& renderer, time_point now);
-        void render_submenu(dreamrender::gui_renderer& renderer, time_point now);
+        void render_crossbar(render::draw_list& renderer, time_point now);
+        void render_submenu(render::draw_list& renderer, time_point now);
+        void draw_icon(render::draw_list& renderer, const menu::menu_entry& entry, float x, float y, float w, float h);
+        bool is_animating(time_point now) const;
 
         enum class direction {
             left,
@@ -46,32 +46,25 @@ namespace app {
         });
 
         {
-            float total_height = 0;
-            float total_width = 0;
-            for(const auto line : std::views::split(message, '\n')) {
-                glm::vec2 size = renderer.measure_text(std::string_view(line), 0.05f);
-                total_height += size.y;
-                total_width = std::max(total_width, size.x);
-            }
-            float y = 0.45f - total_height;
-            for(const auto line : std::views::split(message, '\n')) {
-                std::string_view sv(line);
-                renderer.draw_text(sv, 0.5f-total_width/2, y, 0.05f, glm::vec4(1.0));
-                y += renderer.measure_text(sv, 0.05f).y;
+            const auto& layout = xmb->lay_out_text(renderer, message, 0.05f);
+            float y = 0.45f - layout.size.y;
+            for(const auto& line : layout.lines) {
+                renderer.draw_text(std::string_view(message).substr(line.offset, line.length), 0.5f-layout.size.x/2, y, 0.05f, glm::vec4(1.0));
+                y += line.size.y;
             }
         }
         {
             constexpr float gap = 0.025f;
             float total_width = 0;
             for(const auto& choice : choices) {
-                glm::vec2 size = renderer.measure_text(choice, 0.05f);
+                glm::vec2 size = xmb->measure_text(renderer, choice, 0.05f);
                 total_width += size.x + gap;
             }
             total_width -= gap;
             float x = 0.5f - total_width/2;
             for(unsigned int i=0; i<choices.size(); i++) {
                 const auto& choice = choices[i];
-                auto size = renderer.measure_text(choice, 0.05f);
+                auto size = xmb->measure_text(renderer, choice, 0.05f);
                 if(i == selected) {
                     constexpr glm::vec2 padding{0.010f, 0.005f};
                     float aspect_ratio = (size.x+padding.x) / (size.y+padding.y);
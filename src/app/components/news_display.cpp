@@ -25,6 +25,7 @@ module xmbshell.app;
 import dreamrender;
 import vulkan_hpp;
 import vma;
+import xmbshell.utils;
 
 namespace app {
 
@@ -46,12 +47,14 @@ void news_display::render(dreamrender::gui_renderer& renderer) {
     constexpr float speed = 0.05f;
     constexpr float spacing = 0.025f;
 
-    static auto begin = std::chrono::system_clock::now();
-    auto now = std::chrono::system_clock::now();
+    shell->mark_dirty(dirty_tracker::reason::animation);
+
+    static auto begin = utils::clock::now();
+    auto now = utils::clock::now();
     auto elapsed = std::chrono::duration<float>(now - begin).count() * speed;
 
     std::string_view news = "Lorem ipsum dolor sit amet, consectetur adipiscing elit";
-    float width = renderer.measure_text(news, font_size).x;
+    float width = shell->measure_text(renderer, news, font_size).x;
     float x = std::fmod(elapsed, width + spacing);
 
     renderer.set_clip(base_x, base_y, box_width, font_size);
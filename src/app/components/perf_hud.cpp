@@ -0,0 +1,81 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <string_view>
+
+module xmbshell.app;
+import :perf_hud;
+
+import xmbshell.config;
+import xmbshell.render;
+import glm;
+
+namespace app {
+
+float perf_hud::render(render::draw_list& renderer, float y) {
+    constexpr float graph_width = 0.12f;
+    constexpr float graph_height = 0.02f;
+    constexpr float row_height = 0.025f;
+    constexpr float font_size = 0.05f;
+    constexpr std::size_t bars = 60;
+    constexpr glm::vec4 text_color{0.7f, 0.7f, 0.7f, 1.0f};
+
+    // everything is scaled relative to the frame budget, which is shown as a line at half the graph's height
+    double budget = std::chrono::duration<double, std::milli>(config::CONFIG.frameTime).count();
+    if(budget <= 0.0) {
+        budget = 1000.0 / 60.0;
+    }
+
+    if(!profiler.get_phases().empty()) {
+        renderer.draw_text("CPU time per frame (p50 / p95 / p99):", 0.0f, y, font_size, text_color);
+        y += row_height;
+    }
+    for(const auto& phase : profiler.get_phases()) {
+        const auto& samples = phase.samples;
+        renderer.draw_rect(glm::vec2(0.0f, y), glm::vec2(graph_width, graph_height), glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
+        renderer.draw_rect(glm::vec2(0.0f, y + graph_height/2.0f), glm::vec2(graph_width, 0.001f), glm::vec4(0.5f, 0.5f, 0.5f, 0.75f));
+
+        // every bar shows the slowest of the samples it covers, so spikes do not get lost
+        constexpr std::size_t per_bar = frame_profiler::history_size / bars;
+        std::size_t offset = frame_profiler::history_size - samples.size();
+        for(std::size_t b = offset / per_bar; b < bars; b++) {
+            double value = 0.0;
+            for(std::size_t i = std::max(b*per_bar, offset); i < (b+1)*per_bar; i++) {
+                value = std::max(value, samples.at(i - offset));
+            }
+            float height = static_cast<float>(std::min(value / (2.0*budget), 1.0)) * graph_height;
+            glm::vec4 color = value > budget ? glm::vec4(0.9f, 0.2f, 0.2f, 1.0f) : glm::vec4(0.3f, 0.8f, 0.3f, 1.0f);
+            renderer.draw_rect(glm::vec2(static_cast<float>(b) * graph_width / bars, y + graph_height - height),
+                glm::vec2(graph_width / bars, height), color);
+        }
+
+        auto p = samples.get_percentiles();
+        std::array<char, 128> text;
+        auto end = std::format_to_n(text.data(), text.size(), "{}: {:.2f} / {:.2f} / {:.2f} ms", phase.name, p.p50, p.p95, p.p99).out;
+        renderer.draw_text(std::string_view(text.data(), end), graph_width + 0.005f, y, font_size, text_color);
+        y += row_height;
+    }
+    return y;
+}
+
+}
@@ -0,0 +1,38 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+export module xmbshell.app:perf_hud;
+
+import xmbshell.render;
+import :frame_profiler;
+
+namespace app {
+
+/* Debug overlay showing the frame time graph of every phase measured by a frame_profiler
+ * together with its 50th, 95th and 99th percentile.
+ */
+class perf_hud {
+    public:
+        perf_hud(const frame_profiler& profiler) : profiler(profiler) {}
+        // Draws the HUD starting at "y", returns the y coordinate below it.
+        float render(render::draw_list& renderer, float y);
+    private:
+        const frame_profiler& profiler;
+};
+
+}
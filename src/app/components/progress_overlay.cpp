@@ -78,21 +78,11 @@ namespace app {
             std::pair{action::cancel, "Back"}
         });
 
-        float total_height = 0;
-        float total_width = 0;
-        {
-            std::string_view text = status_message;
-            for(const auto line : std::views::split(text, '\n')) {
-                glm::vec2 size = renderer.measure_text(std::string_view(line), 0.05f);
-                total_height += size.y;
-                total_width = std::max(total_width, size.x);
-            }
-        }
-        float y = 0.425f - total_height;
-        for(const auto line : std::views::split(status_message, '\n')) {
-            std::string_view sv(line);
-            renderer.draw_text(sv, 0.5f-total_width/2, y, 0.05f, glm::vec4(1.0));
-            y += renderer.measure_text(sv, 0.05f).y;
+        const auto& layout = xmb->lay_out_text(renderer, status_message, 0.05f);
+        float y = 0.425f - layout.size.y;
+        for(const auto& line : layout.lines) {
+            renderer.draw_text(std::string_view(status_message).substr(line.offset, line.length), 0.5f-layout.size.x/2, y, 0.05f, glm::vec4(1.0));
+            y += line.size.y;
         }
 
         if(show_progress) {
@@ -53,6 +53,9 @@ export class progress_overlay : public component, public action_receiver {
         result tick(class xmbshell* xmb) override;
         void render(dreamrender::gui_renderer& renderer, class xmbshell* xmb) override;
         result on_action(action action) override;
+
+        // progress is polled from the item every tick
+        [[nodiscard]] bool is_animated() const override { return true; }
     private:
         std::string title;
         std::unique_ptr<progress_item> item;
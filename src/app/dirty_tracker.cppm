@@ -0,0 +1,56 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <atomic>
+#include <utility>
+
+export module xmbshell.app:dirty_tracker;
+
+namespace app {
+
+/* Collects the reasons why the next frame has to be rendered.
+ * Components report into it while ticking or rendering (e.g. a running transition),
+ * input and external requests (D-Bus, config changes) report into it from any thread.
+ * The accesses are sequentially consistent, so a thread going to sleep and one reporting a change always see each other.
+ */
+export class dirty_tracker {
+    public:
+        enum class reason : unsigned int {
+            animation = (1<<0),
+            content   = (1<<1),
+            input     = (1<<2),
+        };
+
+        // Returns whether nothing was reported before.
+        bool mark(reason r) {
+            return reasons.fetch_or(std::to_underlying(r)) == 0;
+        }
+
+        [[nodiscard]] bool has_changes() const {
+            return reasons.load() != 0;
+        }
+
+        // Returns all reasons reported since the last call and resets them.
+        [[nodiscard]] unsigned int consume() {
+            return reasons.exchange(0);
+        }
+    private:
+        std::atomic<unsigned int> reasons{std::to_underlying(reason::content)};
+};
+
+}
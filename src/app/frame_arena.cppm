@@ -0,0 +1,103 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <bit>
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+
+export module xmbshell.app:frame_arena;
+
+import spdlog;
+
+namespace app {
+
+/* Memory for everything that only lives while a frame is rendered (button labels, formatted text, draw lists).
+ * Allocations just bump a pointer in one buffer and reset() frees them all at once at the start of the next frame.
+ * If a frame needed more than the buffer holds, the rest comes from the heap and the buffer grows on the next reset(),
+ * so once the shell reached a steady state, the arena does not allocate from the heap anymore.
+ * Whether whole frames get by without the heap is checked by the "idle" benchmark when built with COUNT_ALLOCATIONS.
+ */
+export class frame_arena {
+    public:
+        constexpr static std::size_t initial_capacity = 64 * 1024;
+
+        frame_arena() {
+            reserve(initial_capacity);
+        }
+        frame_arena(const frame_arena&) = delete;
+        frame_arena& operator=(const frame_arena&) = delete;
+
+        void reset() {
+            std::size_t overflow = upstream.allocated;
+            resource->release();
+            upstream.allocated = 0;
+            if(overflow > 0) {
+                std::size_t size = std::bit_ceil(capacity + overflow);
+                spdlog::debug("Frame arena overflowed by {} bytes, growing it to {} bytes", overflow, size);
+                reserve(size);
+            }
+        }
+
+        std::pmr::memory_resource* get() {
+            return &*resource;
+        }
+
+        // Like std::vformat, but the string is allocated in the arena.
+        std::pmr::string vformat(std::string_view fmt, std::format_args args) {
+            std::pmr::string result(get());
+            std::vformat_to(std::back_inserter(result), fmt, args);
+            return result;
+        }
+    private:
+        // Hands out heap memory to the arena when its buffer is full and remembers how much that was.
+        class counting_resource : public std::pmr::memory_resource {
+            public:
+                std::size_t allocated = 0;
+            private:
+                void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+                    allocated += bytes;
+                    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+                }
+                void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+                    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+                }
+                bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+                    return this == &other;
+                }
+        };
+
+        void reserve(std::size_t size) {
+            resource.reset();
+            buffer = std::make_unique_for_overwrite<std::byte[]>(size);
+            capacity = size;
+            resource.emplace(buffer.get(), capacity, &upstream);
+        }
+
+        counting_resource upstream;
+        std::unique_ptr<std::byte[]> buffer;
+        std::size_t capacity = 0;
+        std::optional<std::pmr::monotonic_buffer_resource> resource;
+};
+
+}
@@ -0,0 +1,177 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+export module xmbshell.app:frame_profiler;
+
+import xmbshell.utils;
+
+namespace app {
+
+/* Measures how much CPU time each phase of a frame takes (ticking, rendering the menu, recording, submitting...).
+ * Phases are timed with scope() and summed up per frame, end_frame() moves the sums into a rolling histogram per phase.
+ */
+export class frame_profiler {
+    public:
+        using clock = std::chrono::steady_clock;
+        using milliseconds = std::chrono::duration<double, std::milli>;
+        constexpr static std::size_t history_size = 240;
+
+        class histogram {
+            public:
+                struct percentiles {
+                    double p50, p95, p99;
+                };
+
+                void push(double value) {
+                    values[next] = value;
+                    next = (next + 1) % history_size;
+                    count = std::min(count + 1, history_size);
+                }
+                std::size_t size() const {
+                    return count;
+                }
+                // i = 0 is the oldest sample still in the history
+                double at(std::size_t i) const {
+                    return values[(next + history_size - count + i) % history_size];
+                }
+                percentiles get_percentiles() const {
+                    if(count == 0) {
+                        return {};
+                    }
+                    std::array<double, history_size> sorted;
+                    auto end = std::copy_n(values.begin(), count, sorted.begin());
+                    std::sort(sorted.begin(), end);
+                    auto p = [&](double q) { return sorted[static_cast<std::size_t>(q * static_cast<double>(count - 1))]; };
+                    return {p(0.50), p(0.95), p(0.99)};
+                }
+            private:
+                std::array<double, history_size> values{};
+                std::size_t next = 0;
+                std::size_t count = 0;
+        };
+
+        struct phase {
+            std::string name;
+            histogram samples;
+            milliseconds current{};
+            bool active = false;
+            std::optional<double> last_sample; // what the last end_frame() pushed, if anything
+        };
+
+        class scoped_timer {
+            public:
+                scoped_timer(frame_profiler* profiler, std::string_view name)
+                    : profiler(profiler), name(profiler ? name : std::string_view{}), start(profiler ? clock::now() : clock::time_point{}) {}
+                ~scoped_timer() {
+                    stop();
+                }
+                // Ends the measurement before the timer goes out of scope.
+                void stop() {
+                    if(profiler) {
+                        profiler->add(name, clock::now() - start);
+                        profiler = nullptr;
+                    }
+                }
+                scoped_timer(const scoped_timer&) = delete;
+                scoped_timer& operator=(const scoped_timer&) = delete;
+            private:
+                frame_profiler* profiler;
+                std::string_view name; // the phase copies it when it is first seen
+                clock::time_point start;
+        };
+
+        // Times everything until the returned timer is destroyed as part of "name".
+        [[nodiscard]] scoped_timer scope(std::string_view name) {
+            return scoped_timer(enabled ? this : nullptr, name);
+        }
+        // Same as above, but the phase is named after the type of "object" (only looked up when enabled).
+        template<typename T>
+        [[nodiscard]] scoped_timer scope(std::string_view prefix, const T& object) {
+            return enabled ? scoped_timer(this, type_name(prefix, typeid(object))) : scoped_timer(nullptr, {});
+        }
+
+        /* "prefix" followed by the name of "type", e.g. for a GPU pass per overlay.
+         * The name is only built the first time and stays valid as long as the profiler, "prefix" has to be a string literal.
+         */
+        std::string_view type_name(std::string_view prefix, const std::type_info& type) {
+            auto key = std::pair{prefix, std::type_index(type)};
+            auto it = type_names.find(key);
+            if(it == type_names.end()) {
+                it = type_names.emplace(key, std::string(prefix)+utils::demangle(type.name())).first;
+            }
+            return it->second;
+        }
+
+        void add(std::string_view name, milliseconds time) {
+            auto it = std::ranges::find(phases, name, &phase::name);
+            if(it == phases.end()) {
+                it = phases.insert(phases.end(), phase{std::string(name)});
+            }
+            it->current += time;
+            it->active = true;
+        }
+
+        // Phases that were not timed in this frame (e.g. an overlay that was closed) do not get a sample.
+        void end_frame() {
+            for(auto& p : phases) {
+                p.last_sample = p.active ? std::optional(p.current.count()) : std::nullopt;
+                if(p.active) {
+                    p.samples.push(p.current.count());
+                }
+                p.current = {};
+                p.active = false;
+            }
+        }
+
+        void set_enabled(bool enable) {
+            if(enabled && !enable) {
+                phases.clear();
+            }
+            enabled = enable;
+        }
+        bool is_enabled() const {
+            return enabled;
+        }
+
+        const std::vector<phase>& get_phases() const {
+            return phases;
+        }
+        const phase* get_phase(std::string_view name) const {
+            auto it = std::ranges::find(phases, name, &phase::name);
+            return it == phases.end() ? nullptr : &*it;
+        }
+    private:
+        bool enabled = false;
+        std::vector<phase> phases;
+        std::map<std::pair<std::string_view, std::type_index>, std::string> type_names;
+};
+
+}
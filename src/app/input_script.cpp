@@ -0,0 +1,135 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+module xmbshell.app;
+import :input_script;
+
+import spdlog;
+import sdl2;
+
+namespace app {
+
+namespace {
+    constexpr std::array key_names = {
+        std::pair{std::string_view{"up"}, SDLK_UP},
+        std::pair{std::string_view{"down"}, SDLK_DOWN},
+        std::pair{std::string_view{"left"}, SDLK_LEFT},
+        std::pair{std::string_view{"right"}, SDLK_RIGHT},
+        std::pair{std::string_view{"return"}, SDLK_RETURN},
+        std::pair{std::string_view{"escape"}, SDLK_ESCAPE},
+        std::pair{std::string_view{"backspace"}, SDLK_BACKSPACE},
+        std::pair{std::string_view{"tab"}, SDLK_TAB},
+        std::pair{std::string_view{"space"}, SDLK_SPACE},
+    };
+}
+
+input_script::input_script(std::vector<step> steps) : steps(std::move(steps)) {
+    std::ranges::stable_sort(this->steps, {}, &step::frame);
+}
+
+input_script input_script::load(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    if(!file) {
+        throw std::runtime_error("Failed to open input script "+path.string());
+    }
+
+    std::vector<step> steps;
+    std::string line;
+    for(unsigned int line_number = 1; std::getline(file, line); line_number++) {
+        if(auto comment = line.find('#'); comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream stream(line);
+        unsigned int frame{};
+        std::string command;
+        if(!(stream >> frame)) {
+            if(line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            throw std::runtime_error(std::format("{}:{}: expected a frame number", path.string(), line_number));
+        }
+        stream >> command;
+        if(command == "key") {
+            std::string name;
+            stream >> name;
+            auto it = std::ranges::find(key_names, name, &decltype(key_names)::value_type::first);
+            if(it == key_names.end()) {
+                throw std::runtime_error(std::format("{}:{}: unknown key \"{}\"", path.string(), line_number, name));
+            }
+            steps.push_back(press(frame, it->second));
+        } else if(command == "blur") {
+            steps.push_back(toggle_blur(frame));
+        } else if(command == "quit") {
+            steps.push_back(quit(frame));
+        } else {
+            throw std::runtime_error(std::format("{}:{}: unknown command \"{}\"", path.string(), line_number, command));
+        }
+    }
+    spdlog::info("Loaded {} steps from input script {}", steps.size(), path.string());
+    return input_script(std::move(steps));
+}
+
+input_script::step input_script::press(unsigned int frame, int32_t key) {
+    return {frame, [key](xmbshell* xmb) {
+        sdl::Keysym sym{};
+        sym.sym = key;
+        xmb->key_down(sym);
+        xmb->key_up(sym);
+    }};
+}
+
+input_script::step input_script::toggle_blur(unsigned int frame) {
+    return {frame, [](xmbshell* xmb) {
+        xmb->set_blur_background(!xmb->get_blur_background());
+    }};
+}
+
+input_script::step input_script::quit(unsigned int frame) {
+    return {frame, [](xmbshell*) {
+        sdl::Event event = {
+            .quit = {
+                .type = sdl::EventType::SDL_QUIT,
+                .timestamp = sdl::GetTicks()
+            }
+        };
+        sdl::PushEvent(&event);
+    }};
+}
+
+void input_script::frame(xmbshell* xmb) {
+    while(next < steps.size() && steps[next].frame <= current_frame) {
+        steps[next].action(xmb);
+        next++;
+    }
+    current_frame++;
+}
+
+}
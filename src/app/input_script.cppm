@@ -0,0 +1,67 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+export module xmbshell.app:input_script;
+
+namespace app {
+
+class xmbshell;
+
+/* A sequence of input events keyed to frame numbers instead of wall-clock time,
+ * so a scripted run does the same thing in every frame no matter how fast the frames are rendered.
+ *
+ * Script files contain one step per line ("#" starts a comment):
+ *   <frame> key <name>    press and release a key (up, down, left, right, return, escape, backspace, tab, space)
+ *   <frame> blur          toggle the background blur
+ *   <frame> quit          quit the shell
+ */
+export class input_script {
+    public:
+        struct step {
+            unsigned int frame;
+            std::function<void(xmbshell*)> action;
+        };
+
+        input_script() = default;
+        input_script(std::vector<step> steps);
+
+        // Throws std::runtime_error if the file cannot be read or contains an invalid line.
+        static input_script load(const std::filesystem::path& path);
+
+        static step press(unsigned int frame, int32_t key);
+        static step toggle_blur(unsigned int frame);
+        static step quit(unsigned int frame);
+
+        // Runs all steps of the current frame and moves on to the next one.
+        void frame(xmbshell* xmb);
+        unsigned int get_frame() const {
+            return current_frame;
+        }
+    private:
+        std::vector<step> steps; // sorted by frame
+        std::size_t next = 0;
+        unsigned int current_frame = 0;
+};
+
+}
@@ -19,6 +19,7 @@ module;
 export module xmbshell.app:blur_layer;
 
 import dreamrender;
+import xmbshell.render;
 import vulkan_hpp;
 import :component;
 
@@ -30,15 +31,6 @@ export class blur_layer : public component {
 
         void render(dreamrender::gui_renderer& renderer, class xmbshell* xmb) override;
         [[nodiscard]] bool is_opaque() const override { return false; }
-    private:
-        dreamrender::texture srcTexture;
-        dreamrender::texture dstTexture;
-
-        vk::UniqueDescriptorSetLayout descriptorSetLayout;
-        vk::UniqueDescriptorPool descriptorPool;
-        vk::DescriptorSet descriptorSet;
-        vk::UniquePipelineLayout pipelineLayout;
-        vk::UniquePipeline pipeline;
 };
 
 }
@@ -0,0 +1,95 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+export module xmbshell.app:pipeline_builder;
+
+import spdlog;
+import xmbshell.trace;
+import xmbshell.utils;
+
+namespace app {
+
+/* Creates pipelines on worker threads while the main thread goes on with the preload.
+ * Every job gets its own thread and should only create objects nobody else touches until the job is joined with wait(),
+ * the pipeline cache they share is synchronized by the driver.
+ * Exceptions thrown by a job are rethrown by wait().
+ */
+export class pipeline_builder {
+    public:
+        pipeline_builder() = default;
+        pipeline_builder(const pipeline_builder&) = delete;
+        pipeline_builder& operator=(const pipeline_builder&) = delete;
+        ~pipeline_builder() {
+            // the jobs reference objects of the owner, so they must not outlive it
+            for(auto& j : jobs) {
+                j.future.wait();
+            }
+        }
+
+        void submit(std::string name, std::function<void()> build) {
+            auto future = std::async(std::launch::async, [name, build = std::move(build)] {
+                trace::scope span("create pipelines", name);
+                auto start = std::chrono::steady_clock::now();
+                build();
+                spdlog::debug("Created {} pipelines in {} ms", name,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+            });
+            jobs.push_back(job{std::move(name), std::move(future)});
+        }
+
+        // Whether wait("name") would return right away.
+        bool is_ready(std::string_view name) const {
+            auto it = std::ranges::find(jobs, name, &job::name);
+            return it == jobs.end() || utils::is_ready(it->future);
+        }
+
+        // Blocks until the job "name" has finished, does nothing if it was already joined (or never submitted).
+        void wait(std::string_view name) {
+            auto it = std::ranges::find(jobs, name, &job::name);
+            if(it == jobs.end()) {
+                return;
+            }
+            auto future = std::move(it->future);
+            jobs.erase(it);
+            if(!utils::is_ready(future)) {
+                trace::scope span("wait for pipelines", name);
+                auto start = std::chrono::steady_clock::now();
+                future.wait();
+                spdlog::debug("Waited {} ms for the {} pipelines",
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), name);
+            }
+            future.get();
+        }
+    private:
+        struct job {
+            std::string name;
+            std::future<void> future;
+        };
+        std::vector<job> jobs;
+};
+
+}
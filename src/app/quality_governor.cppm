@@ -0,0 +1,179 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+export module xmbshell.app:quality_governor;
+
+namespace app {
+
+/* Decides when the quality should go down or up, from the cost of every rendered frame compared to the frame budget
+ * (see config::frameTime). The cost is smoothed, the quality goes down if frames keep costing more than
+ * degrade_threshold of the budget, and up again only after frames cost less than upgrade_threshold for a while.
+ * The gap between both thresholds and the growing delay before another upgrade keep it from oscillating between two steps.
+ */
+export class load_hysteresis {
+    public:
+        enum class decision { keep, degrade, upgrade };
+
+        constexpr static double degrade_threshold = 0.9;
+        constexpr static double upgrade_threshold = 0.6;
+        constexpr static unsigned int degrade_frames = 30;
+        constexpr static unsigned int upgrade_frames = 180;
+        constexpr static unsigned int max_upgrade_backoff = 8;
+
+        // "can_degrade" and "can_upgrade" tell whether there is a step left in that direction.
+        decision frame(std::chrono::duration<double> cost, std::chrono::duration<double> budget, bool can_degrade, bool can_upgrade) {
+            constexpr double smoothing = 0.1;
+            smoothed = smoothed < 0.0 ? cost.count() : smoothed + (cost.count() - smoothed) * smoothing;
+            frames_since_change++;
+
+            double load = smoothed / budget.count();
+            over = load > degrade_threshold ? over + 1 : 0;
+            under = load < upgrade_threshold ? under + 1 : 0;
+
+            if(over >= degrade_frames && can_degrade) {
+                // falling back right after an upgrade means the upgrade was too optimistic, so wait longer next time
+                if(upgraded && frames_since_change < 2 * upgrade_frames * backoff) {
+                    backoff = std::min(backoff * 2, max_upgrade_backoff);
+                }
+                changed(false);
+                return decision::degrade;
+            }
+            if(under >= upgrade_frames * backoff && can_upgrade) {
+                changed(true);
+                return decision::upgrade;
+            }
+            return decision::keep;
+        }
+
+        void reset() {
+            changed(false);
+            backoff = 1;
+            smoothed = -1.0;
+        }
+    private:
+        void changed(bool upgrade) {
+            upgraded = upgrade;
+            over = under = 0;
+            frames_since_change = 0;
+        }
+
+        double smoothed = -1.0;
+        unsigned int over = 0;
+        unsigned int under = 0;
+        unsigned int frames_since_change = 0;
+        unsigned int backoff = 1;
+        bool upgraded = false;
+};
+
+/* Steps through quality levels so that rendering a frame fits into the frame budget.
+ * It is fed with the cost of every rendered frame (the larger of CPU and GPU time), see load_hysteresis.
+ */
+export class quality_governor {
+    public:
+        struct level {
+            unsigned int wave_grid;         // see render::wave_renderer::set_grid_quality
+            unsigned int backdrop_interval; // an animated backdrop is only blurred again every n-th frame
+            float background_scale;         // upper limit for config::backgroundScale
+            unsigned int blur_downscale;    // see render::blur_pass::set_downscale
+        };
+        constexpr static std::array levels = {
+            level{0, 1, 1.0f, 0},
+            level{1, 1, 1.0f, 0},
+            level{1, 2, 0.75f, 0},
+            level{2, 2, 0.75f, 1},
+            level{2, 4, 0.5f, 1},
+        };
+
+        // Returns whether the level changed.
+        bool frame(std::chrono::duration<double> cost, std::chrono::duration<double> budget) {
+            switch(load.frame(cost, budget, current + 1 < levels.size(), current > 0)) {
+                case load_hysteresis::decision::degrade:
+                    current++;
+                    return true;
+                case load_hysteresis::decision::upgrade:
+                    current--;
+                    return true;
+                case load_hysteresis::decision::keep:
+                    break;
+            }
+            return false;
+        }
+
+        void reset() {
+            current = 0;
+            load.reset();
+        }
+
+        unsigned int get_level() const {
+            return current;
+        }
+        const level& get() const {
+            return levels[current];
+        }
+    private:
+        unsigned int current = 0;
+        load_hysteresis load;
+};
+
+/* Chooses the internal render resolution (as a fraction of the swapchain size) from the GPU time of the frames,
+ * with the same hysteresis and upgrade backoff as the quality_governor. That matters even more here, because every
+ * change waits for the GPU and recreates the render targets. The scale changes in steps for the same reason.
+ */
+export class resolution_governor {
+    public:
+        constexpr static float step = 0.125f;
+
+        // Returns whether the scale changed.
+        bool frame(std::chrono::duration<double> gpu_time, std::chrono::duration<double> budget, float min_scale) {
+            float target = scale;
+            switch(load.frame(gpu_time, budget, scale > min_scale, scale < 1.0f)) {
+                case load_hysteresis::decision::degrade:
+                    target = std::max(min_scale, scale - step);
+                    break;
+                case load_hysteresis::decision::upgrade:
+                    target = std::min(1.0f, scale + step);
+                    break;
+                case load_hysteresis::decision::keep:
+                    target = std::max(min_scale, scale);
+                    break;
+            }
+            if(target == scale) {
+                return false;
+            }
+            scale = target;
+            return true;
+        }
+
+        void reset() {
+            scale = 1.0f;
+            load.reset();
+        }
+
+        float get_scale() const {
+            return scale;
+        }
+    private:
+        float scale = 1.0f;
+        load_hysteresis load;
+};
+
+}
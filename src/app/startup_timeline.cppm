@@ -0,0 +1,90 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+export module xmbshell.app:startup_timeline;
+
+import spdlog;
+
+namespace app {
+
+/* Timestamps of the startup stages, relative to the start of the process.
+ * The shell shows the background as soon as it is ready and loads the rest while it is already presenting frames,
+ * so the time to the first frame and the time until the menus accept input are measured separately.
+ * The times can be read from any thread (e.g. by the D-Bus server).
+ */
+export class startup_timeline {
+    public:
+        using clock = std::chrono::steady_clock;
+        using milliseconds = std::chrono::duration<double, std::milli>;
+
+        enum class stage : unsigned int {
+            window,     // window and swapchain
+            background, // background and wave renderers
+            fonts,      // fonts and button icons
+            menus,      // crossbar and news
+            first_frame,
+            interactive, // first frame showing the menus
+            _length
+        };
+        constexpr static std::array<std::string_view, std::to_underlying(stage::_length)> stage_names = {
+            "window", "background", "fonts", "menus", "first frame", "interactive"
+        };
+
+        startup_timeline() {
+            for(auto& t : times) {
+                t.store(-1.0, std::memory_order_relaxed);
+            }
+        }
+
+        void set_origin(clock::time_point origin) {
+            this->origin = origin;
+        }
+
+        // Records the first time "s" is reached, later calls are ignored.
+        void mark(stage s) {
+            auto& time = times[std::to_underlying(s)];
+            if(time.load(std::memory_order_relaxed) >= 0.0) {
+                return;
+            }
+            auto elapsed = milliseconds(clock::now() - origin);
+            time.store(elapsed.count(), std::memory_order_relaxed);
+            spdlog::info("Startup: {} ready after {:.1f} ms", stage_names[std::to_underlying(s)], elapsed.count());
+        }
+        bool reached(stage s) const {
+            return times[std::to_underlying(s)].load(std::memory_order_relaxed) >= 0.0;
+        }
+        std::optional<milliseconds> get(stage s) const {
+            double time = times[std::to_underlying(s)].load(std::memory_order_relaxed);
+            if(time < 0.0) {
+                return std::nullopt;
+            }
+            return milliseconds(time);
+        }
+    private:
+        clock::time_point origin = clock::now();
+        std::array<std::atomic<double>, std::to_underlying(stage::_length)> times; // negative until reached
+};
+
+}
@@ -0,0 +1,389 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+
+module xmbshell.app;
+
+import :thumbnailer;
+
+import avcpp;
+import glibmm;
+import spdlog;
+import xmbshell.constants;
+import xmbshell.trace;
+
+namespace app {
+
+namespace {
+    constexpr std::string_view png_signature = "\x89PNG\r\n\x1a\n";
+    constexpr std::size_t ihdr_end = png_signature.size() + 4 + 4 + 13 + 4; // length, type, data and CRC of the IHDR chunk
+
+    constexpr auto crc_table = []{
+        std::array<std::uint32_t, 256> table{};
+        for(std::uint32_t n = 0; n < table.size(); n++) {
+            std::uint32_t c = n;
+            for(int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }();
+    std::uint32_t crc32(std::string_view data) {
+        std::uint32_t c = 0xffffffffu;
+        for(char ch : data) {
+            c = crc_table[(c ^ static_cast<std::uint8_t>(ch)) & 0xff] ^ (c >> 8);
+        }
+        return c ^ 0xffffffffu;
+    }
+
+    void append_u32(std::string& out, std::uint32_t value) {
+        for(int shift = 24; shift >= 0; shift -= 8) {
+            out += static_cast<char>((value >> shift) & 0xff);
+        }
+    }
+    std::uint32_t read_u32(std::string_view in) {
+        std::uint32_t value = 0;
+        for(int i = 0; i < 4; i++) {
+            value = (value << 8) | static_cast<std::uint8_t>(in[i]);
+        }
+        return value;
+    }
+
+    std::string text_chunk(std::string_view key, std::string_view value) {
+        std::string body = "tEXt";
+        body += key;
+        body += '\0';
+        body += value;
+
+        std::string chunk;
+        append_u32(chunk, body.size() - 4);
+        chunk += body;
+        append_u32(chunk, crc32(body));
+        return chunk;
+    }
+
+    // The tEXt entries of a PNG file, the spec wants them in front of the image data, so we stop there.
+    std::map<std::string, std::string, std::less<>> read_text_chunks(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+        std::map<std::string, std::string, std::less<>> text;
+        if(!data.starts_with(png_signature)) {
+            return text;
+        }
+        std::string_view view = data;
+        std::size_t pos = png_signature.size();
+        while(pos + 12 <= view.size()) {
+            std::size_t length = read_u32(view.substr(pos));
+            std::string_view type = view.substr(pos + 4, 4);
+            if(type == "IDAT" || pos + 12 + length > view.size()) {
+                break;
+            }
+            if(type == "tEXt") {
+                std::string_view body = view.substr(pos + 8, length);
+                if(auto separator = body.find('\0'); separator != std::string_view::npos) {
+                    text.emplace(body.substr(0, separator), body.substr(separator + 1));
+                }
+            }
+            pos += 12 + length;
+        }
+        return text;
+    }
+
+    av::VideoFrame decode_image(const std::filesystem::path& path) {
+        av::FormatContext ictx;
+        ictx.openInput(path.string());
+        ictx.findStreamInfo();
+
+        av::Stream stream;
+        for(std::size_t i = 0; i < ictx.streamsCount(); ++i) {
+            if(auto st = ictx.stream(i); st.mediaType() == AVMEDIA_TYPE_VIDEO) {
+                stream = st;
+                break;
+            }
+        }
+        if(!stream.isValid()) {
+            throw std::runtime_error("No image stream found");
+        }
+
+        av::VideoDecoderContext decoder{stream};
+        decoder.setCodec(av::findDecodingCodec(decoder.raw()->codec_id));
+        decoder.open();
+        while(true) {
+            av::Packet pkt = ictx.readPacket();
+            if(pkt.isNull()) {
+                break;
+            }
+            if(pkt.streamIndex() != stream.index()) {
+                continue;
+            }
+            if(av::VideoFrame frame = decoder.decode(pkt)) {
+                return frame;
+            }
+        }
+        // some decoders only hand out the frame once they are flushed
+        if(av::VideoFrame frame = decoder.decode(av::Packet{})) {
+            return frame;
+        }
+        throw std::runtime_error("The image could not be decoded");
+    }
+
+    // Scales "frame" down (never up) to fit into max_size x max_size and converts it to RGBA.
+    av::VideoFrame scale_down(const av::VideoFrame& frame, unsigned int max_size) {
+        const int width = frame.width();
+        const int height = frame.height();
+        const double scale = std::min(1.0, static_cast<double>(max_size) / std::max(width, height));
+        const int w = std::max(1, static_cast<int>(std::lround(width * scale)));
+        const int h = std::max(1, static_cast<int>(std::lround(height * scale)));
+
+        av::VideoRescaler rescaler{
+            /* dst */ w, h, AV_PIX_FMT_RGBA,
+            /* src */ width, height, frame.pixelFormat(),
+            SWS_AREA
+        };
+        return rescaler.rescale(frame);
+    }
+
+    std::string encode_png(av::VideoFrame scaled) {
+        av::VideoEncoderContext encoder{av::findEncodingCodec(AV_CODEC_ID_PNG)};
+        encoder.setWidth(scaled.width());
+        encoder.setHeight(scaled.height());
+        encoder.setPixelFormat(AV_PIX_FMT_RGBA);
+        encoder.setTimeBase(av::Rational{1, 1});
+        encoder.open();
+
+        scaled.setTimeBase(encoder.timeBase());
+        scaled.setPts(av::Timestamp{0, encoder.timeBase()});
+        av::Packet packet = encoder.encode(scaled);
+        if(!packet) {
+            packet = encoder.encode();
+        }
+        if(!packet) {
+            throw std::runtime_error("The PNG encoder did not return an image");
+        }
+        return std::string(reinterpret_cast<const char*>(packet.data()), packet.size()); // NOLINT
+    }
+
+    thumbnailer::image to_image(const av::VideoFrame& scaled) {
+        thumbnailer::image result{static_cast<unsigned int>(scaled.width()), static_cast<unsigned int>(scaled.height()), {}};
+        const std::size_t row = std::size_t{result.width} * 4;
+        result.pixels.resize(row * result.height);
+        for(unsigned int y = 0; y < result.height; y++) {
+            std::copy_n(scaled.data(0) + std::size_t{y} * scaled.raw()->linesize[0], row, result.pixels.begin() + y * row);
+        }
+        return result;
+    }
+
+    // What the spec suggests for a fail entry: an (empty) image that only carries the text entries.
+    std::string encode_empty_png() {
+        av::VideoFrame pixel{AV_PIX_FMT_RGBA, 1, 1};
+        std::fill_n(pixel.data(0), 4, std::uint8_t{0});
+        return encode_png(std::move(pixel));
+    }
+
+    // Adds the "text" entries to "png" and writes it to "target" without anyone ever seeing a half written file.
+    void write_thumbnail(const std::filesystem::path& target, std::string png, const std::vector<std::pair<std::string_view, std::string>>& text) {
+        if(!png.starts_with(png_signature) || png.size() < ihdr_end) {
+            throw std::runtime_error("The PNG encoder returned an invalid image");
+        }
+        std::string chunks;
+        for(const auto& [key, value] : text) {
+            chunks += text_chunk(key, value);
+        }
+        png.insert(ihdr_end, chunks);
+
+        auto directory = target.parent_path();
+        if(std::filesystem::create_directories(directory)) {
+            // the cache tells which files the user has looked at, so it is only for their eyes
+            std::filesystem::permissions(directory.parent_path(), std::filesystem::perms::owner_all);
+            std::filesystem::permissions(directory, std::filesystem::perms::owner_all);
+        }
+
+        auto temporary = target;
+        temporary += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary);
+            out.write(png.data(), static_cast<std::streamsize>(png.size()));
+            if(!out) {
+                throw std::runtime_error("Cannot write "+temporary.string());
+            }
+        }
+        std::filesystem::permissions(temporary, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+        std::filesystem::rename(temporary, target);
+    }
+}
+
+unsigned int thumbnailer::default_thread_count() {
+    // decoding big photos is heavy, so leave most of the cores to the rest of the shell
+    return std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+}
+
+thumbnailer::thumbnailer(unsigned int threads) {
+    workers.resize(threads);
+}
+
+thumbnailer::~thumbnailer() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for(auto& w : workers) {
+        if(w.joinable()) {
+            w.join();
+        }
+    }
+}
+
+thumbnailer::request thumbnailer::create(std::filesystem::path path, std::string uri, std::uint64_t mtime, unsigned int icon_size, std::filesystem::path cached) {
+    auto j = std::make_shared<job>();
+    j->path = std::move(path);
+    j->uri = std::move(uri);
+    j->mtime = mtime;
+    j->cached = std::move(cached);
+    j->icon_size = icon_size;
+    {
+        std::lock_guard lock(mutex);
+        queue.push_back(j);
+    }
+    // the threads are only started once the first image is shown
+    for(auto& w : workers) {
+        if(!w.joinable()) {
+            w = std::thread(&thumbnailer::work, this);
+        }
+    }
+    cv.notify_one();
+    return request(std::move(j));
+}
+
+std::filesystem::path thumbnailer::get_cache_path(std::string_view uri, size s) {
+    auto name = Glib::Checksum::compute_checksum(Glib::Checksum::Type::MD5, std::string(uri)) + ".png";
+    return std::filesystem::path(Glib::get_user_cache_dir()) / "thumbnails" / (s == size::large ? "large" : "normal") / name;
+}
+
+std::filesystem::path thumbnailer::get_fail_path(std::string_view uri) {
+    auto name = Glib::Checksum::compute_checksum(Glib::Checksum::Type::MD5, std::string(uri)) + ".png";
+    return std::filesystem::path(Glib::get_user_cache_dir()) / "thumbnails" / "fail" /
+        std::format("{}-{}", constants::name, constants::version) / name;
+}
+
+void thumbnailer::work() {
+    trace::set_thread_name("thumbnailer");
+    while(true) {
+        std::shared_ptr<job> j;
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this]{ return stopping || !queue.empty(); });
+            if(stopping) {
+                return;
+            }
+            j = queue.front().lock();
+            queue.pop_front();
+        }
+        if(!j) {
+            continue; // nobody is waiting for it anymore
+        }
+        j->result = process(*j);
+        j->done.store(true, std::memory_order_release);
+    }
+}
+
+std::optional<thumbnailer::image> thumbnailer::process(const job& j) {
+    const std::string name = j.path.filename().string();
+    trace::scope span("thumbnail", name);
+
+    const auto large = get_cache_path(j.uri, size::large);
+    const auto fail = get_fail_path(j.uri);
+    const std::string mtime = std::to_string(j.mtime);
+    bool decoding = false;
+    try {
+        if(!j.cached.empty()) {
+            return to_image(scale_down(decode_image(j.cached), j.icon_size));
+        }
+        if(std::filesystem::exists(large)) {
+            auto text = read_text_chunks(large);
+            if(text["Thumb::URI"] == j.uri && text["Thumb::MTime"] == mtime) {
+                return to_image(scale_down(decode_image(large), j.icon_size));
+            }
+        }
+
+        if(std::filesystem::exists(fail)) {
+            auto text = read_text_chunks(fail);
+            if(text["Thumb::URI"] == j.uri && text["Thumb::MTime"] == mtime) {
+                spdlog::trace("Not trying to thumbnail {} again", j.path.string());
+                return std::nullopt;
+            }
+        }
+
+        decoding = true;
+        av::VideoFrame frame = decode_image(j.path);
+        decoding = false;
+        const std::vector<std::pair<std::string_view, std::string>> text = {
+            {"Thumb::URI", j.uri},
+            {"Thumb::MTime", mtime},
+            {"Thumb::Image::Width", std::to_string(frame.width())},
+            {"Thumb::Image::Height", std::to_string(frame.height())},
+            {"Software", "XMBShell"},
+        };
+        for(auto s : {size::normal, size::large}) {
+            write_thumbnail(get_cache_path(j.uri, s), encode_png(scale_down(frame, std::to_underlying(s))), text);
+        }
+        spdlog::debug("Created thumbnails of {}", j.path.string());
+        return to_image(scale_down(frame, j.icon_size));
+    } catch(const std::exception& e) {
+        spdlog::warn("Failed to create a thumbnail of {}: {}", j.path.string(), e.what());
+        // only the image itself is to blame if it cannot be decoded, failing to write the cache is not a reason to give up on it
+        if(decoding) {
+            try {
+                write_thumbnail(fail, encode_empty_png(), {
+                    {"Thumb::URI", j.uri},
+                    {"Thumb::MTime", mtime},
+                    {"Software", "XMBShell"},
+                });
+            } catch(const std::exception& e) {
+                spdlog::warn("Failed to remember that {} cannot be thumbnailed: {}", j.path.string(), e.what());
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+}
@@ -0,0 +1,113 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+export module xmbshell.app:thumbnailer;
+
+namespace app {
+
+/* Creates thumbnails of images on worker threads and keeps them in the freedesktop thumbnail cache
+ * (https://specifications.freedesktop.org/thumbnail-spec/latest/), so other applications can use them as well.
+ * Every image is decoded once and written in the "normal" (128 px) and "large" (256 px) sizes.
+ * Thumbnails that are already in the cache are only used if their Thumb::URI and Thumb::MTime still match the image.
+ * Images that cannot be decoded get an entry in the "fail" directory of the cache, so they are not tried again until they change.
+ * The caller gets the pixels of the thumbnail scaled to the size it asked for, ready to be uploaded (e.g. into a render::icon_atlas).
+ */
+export class thumbnailer {
+    public:
+        enum class size : unsigned int {
+            normal = 128,
+            large = 256,
+        };
+
+        struct image {
+            unsigned int width;
+            unsigned int height;
+            std::vector<std::uint8_t> pixels; // RGBA, tightly packed rows
+        };
+
+    private:
+        struct job {
+            std::filesystem::path path;
+            std::string uri;
+            std::uint64_t mtime;
+            std::filesystem::path cached;
+            unsigned int icon_size;
+            std::optional<image> result;
+            std::atomic<bool> done = false;
+        };
+
+    public:
+        class request {
+            public:
+                bool is_ready() const {
+                    return j->done.load(std::memory_order_acquire);
+                }
+                // The thumbnail, or nothing if the image could not be thumbnailed. Only valid once is_ready().
+                const std::optional<image>& get() const {
+                    return j->result;
+                }
+            private:
+                explicit request(std::shared_ptr<job> j) : j(std::move(j)) {}
+                std::shared_ptr<job> j;
+                friend class thumbnailer;
+        };
+
+        explicit thumbnailer(unsigned int threads = default_thread_count());
+        // Waits for the images currently being thumbnailed, the ones still queued are dropped.
+        ~thumbnailer();
+
+        thumbnailer(const thumbnailer&) = delete;
+        thumbnailer& operator=(const thumbnailer&) = delete;
+
+        /* Queues a thumbnail for "path", whose URI is "uri" and which was last modified at "mtime" (in seconds since the epoch),
+         * scaled to fit into icon_size x icon_size. If "cached" is given, it is a thumbnail already known to be up to date and
+         * is used instead of the image. The job is dropped if the request is destroyed before a worker gets to it.
+         */
+        request create(std::filesystem::path path, std::string uri, std::uint64_t mtime, unsigned int icon_size, std::filesystem::path cached = {});
+
+        // Where the thumbnail of "uri" in the given size is stored.
+        static std::filesystem::path get_cache_path(std::string_view uri, size s);
+        // Where the shell remembers that it failed to thumbnail "uri".
+        static std::filesystem::path get_fail_path(std::string_view uri);
+    private:
+        static unsigned int default_thread_count();
+
+        void work();
+        std::optional<image> process(const job& j);
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::weak_ptr<job>> queue;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+};
+
+}
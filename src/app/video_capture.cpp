@@ -0,0 +1,274 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/pixfmt.h>
+
+module xmbshell.app;
+import :video_capture;
+
+import avcpp;
+import dreamrender;
+import spdlog;
+import vma;
+import vulkan_hpp;
+import xmbshell.trace;
+
+namespace app {
+
+namespace {
+    av::PixelFormat pixel_format(vk::Format format) {
+        switch(format) {
+            case vk::Format::eB8G8R8A8Unorm:
+            case vk::Format::eB8G8R8A8Srgb:
+                return AV_PIX_FMT_BGRA;
+            case vk::Format::eR8G8B8A8Unorm:
+            case vk::Format::eR8G8B8A8Srgb:
+                return AV_PIX_FMT_RGBA;
+            default:
+                throw std::runtime_error("Cannot capture swapchain images with format "+vk::to_string(format));
+        }
+    }
+}
+
+video_capture::video_capture(vk::Device device, vma::Allocator allocator, vk::Extent2D extent, vk::Format format,
+    unsigned int frames, const std::filesystem::path& output, double fps, bool live)
+    : device(device), allocator(allocator), extent(extent), output(output), live(live), source_format(pixel_format(format))
+{
+    const vk::DeviceSize size = static_cast<vk::DeviceSize>(extent.width) * extent.height * 4;
+    readbacks.resize(frames);
+    for(unsigned int i = 0; i < frames; i++) {
+        vk::BufferCreateInfo buffer_info({}, size, vk::BufferUsageFlagBits::eTransferDst, vk::SharingMode::eExclusive);
+        vma::AllocationCreateInfo alloc_info({}, vma::MemoryUsage::eGpuToCpu);
+        std::tie(readbacks[i].buffer, readbacks[i].allocation) = allocator.createBufferUnique(buffer_info, alloc_info);
+        dreamrender::debugName(device, readbacks[i].buffer.get(), "Video Capture Readback Buffer #"+std::to_string(i));
+    }
+
+    // the container is guessed from the file name, the codec is the default video codec of the container
+    av::OutputFormat output_format;
+    output_format.setFormat(std::string{}, output.string());
+    octx.setFormat(output_format);
+    av::Codec codec = av::findEncodingCodec(output_format);
+
+    const int rate = std::max(1, static_cast<int>(std::lround(fps)));
+    encoder = av::VideoEncoderContext{codec};
+    encoder.setWidth(static_cast<int>(extent.width));
+    encoder.setHeight(static_cast<int>(extent.height));
+    encoder.setPixelFormat(AV_PIX_FMT_YUV420P);
+    encoder.setTimeBase(av::Rational{1, rate});
+    if(output_format.isFlags(AVFMT_GLOBALHEADER)) {
+        encoder.addFlags(AV_CODEC_FLAG_GLOBAL_HEADER);
+    }
+    // favour speed, the encoder has to keep up with the render loop
+    encoder.open({{"threads", "auto"}, {"deadline", "realtime"}, {"cpu-used", "8"}, {"row-mt", "1"}, {"preset", "veryfast"}});
+
+    stream = octx.addStream(encoder);
+    stream.setFrameRate(av::Rational{rate, 1});
+    stream.setTimeBase(encoder.timeBase());
+
+    rescaler = av::VideoRescaler{
+        /* dst */ encoder.width(), encoder.height(), encoder.pixelFormat(),
+        /* src */ encoder.width(), encoder.height(), source_format
+    };
+
+    octx.openOutput(output.string());
+    octx.writeHeader();
+    spdlog::info("Encoding {}x{} frames at {} FPS to {} ({})", extent.width, extent.height, rate, output.string(), codec.name());
+
+    encoder_thread = std::thread(&video_capture::encode_loop, this);
+}
+
+video_capture::~video_capture() {
+    // the last frames in flight have not been collected yet
+    device.waitIdle();
+    std::vector<int> pending;
+    for(int i = 0; i < static_cast<int>(readbacks.size()); i++) {
+        if(readbacks[i].pts) {
+            pending.push_back(i);
+        }
+    }
+    std::ranges::sort(pending, {}, [this](int i) { return *readbacks[i].pts; });
+    for(int i : pending) {
+        collect(i);
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    encoder_thread.join();
+
+    if(dropped_frames > 0 || out_of_order_frames > 0) {
+        spdlog::warn("{} frames were dropped from {}: {} because the encoder could not keep up, {} because they arrived out of order",
+            dropped_frames + out_of_order_frames, output.string(), dropped_frames, out_of_order_frames);
+    }
+}
+
+void video_capture::collect(int frame) {
+    auto& readback = readbacks[frame];
+    if(!readback.pts) {
+        return;
+    }
+    const std::int64_t pts = *std::exchange(readback.pts, std::nullopt);
+    const std::size_t size = static_cast<std::size_t>(extent.width) * extent.height * 4;
+
+    std::vector<std::uint8_t> pixels;
+    {
+        std::unique_lock lock(mutex);
+        if(queue.size() >= max_queued_frames) {
+            if(live) {
+                dropped_frames++;
+                return;
+            }
+            trace::scope span("wait for encoder");
+            space.wait(lock, [this]{ return queue.size() < max_queued_frames; });
+        }
+        if(!free_buffers.empty()) {
+            pixels = std::move(free_buffers.back());
+            free_buffers.pop_back();
+        }
+    }
+    pixels.resize(size);
+    allocator.copyAllocationToMemory(readback.allocation.get(), 0, pixels.data(), size);
+    {
+        std::lock_guard lock(mutex);
+        queue.push_back({pts, std::move(pixels)});
+    }
+    cv.notify_one();
+}
+
+void video_capture::record(vk::CommandBuffer cmd, int frame, vk::Image image, vk::ImageLayout layout) {
+    const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+    {
+        vk::ImageMemoryBarrier barrier(vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eTransferRead,
+            layout, vk::ImageLayout::eTransferSrcOptimal, vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, image, range);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+    }
+    vk::BufferImageCopy region(0, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+        vk::Offset3D(0, 0, 0), vk::Extent3D(extent, 1));
+    cmd.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, readbacks[frame].buffer.get(), region);
+    {
+        vk::ImageMemoryBarrier image_barrier(vk::AccessFlagBits::eTransferRead, {},
+            vk::ImageLayout::eTransferSrcOptimal, layout, vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, image, range);
+        vk::BufferMemoryBarrier buffer_barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead,
+            vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, readbacks[frame].buffer.get(), 0, vk::WholeSize);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eBottomOfPipe, {}, {}, buffer_barrier, image_barrier);
+    }
+    readbacks[frame].pts = next_pts++;
+}
+
+void video_capture::encode_loop() {
+    trace::set_thread_name("encoder");
+    while(true) {
+        queued_frame frame;
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this]{ return stopping || !queue.empty(); });
+            if(queue.empty()) {
+                break;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        space.notify_one();
+
+        // frames are collected in the order the swapchain hands out its images, which is not guaranteed to be the order they were rendered in
+        if(live) {
+            // a frame older than the last encoded one can no longer be encoded
+            if(frame.pts <= last_pts) {
+                out_of_order_frames++;
+                std::lock_guard lock(mutex);
+                free_buffers.push_back(std::move(frame.pixels));
+                continue;
+            }
+            encode(frame);
+        } else {
+            held_frames.emplace(frame.pts, std::move(frame));
+            while(!held_frames.empty() && held_frames.begin()->first == last_pts + 1) {
+                encode(held_frames.begin()->second);
+                held_frames.erase(held_frames.begin());
+            }
+        }
+    }
+    // only happens if a frame was never collected
+    for(auto& [pts, frame] : held_frames) {
+        encode(frame);
+    }
+    held_frames.clear();
+
+    try {
+        // drain the frames the encoder is still holding back
+        for(av::Packet packet = encoder.encode(); packet; packet = encoder.encode()) {
+            packet.setStreamIndex(stream.index());
+            octx.writePacket(packet);
+        }
+        octx.writeTrailer();
+        spdlog::info("Finished encoding {} frames to {}", encoded_frames, output.string());
+    } catch(const std::exception& e) {
+        spdlog::error("Failed to finish {}: {}", output.string(), e.what());
+    }
+}
+
+void video_capture::encode(queued_frame& frame) {
+    if(!failed) {
+        trace::scope span("encode frame");
+        try {
+            av::VideoFrame input(frame.pixels.data(), frame.pixels.size(), source_format,
+                static_cast<int>(extent.width), static_cast<int>(extent.height));
+            av::VideoFrame converted = rescaler.rescale(input);
+            converted.setTimeBase(encoder.timeBase());
+            converted.setPts(av::Timestamp{frame.pts, encoder.timeBase()});
+            write(converted);
+            encoded_frames++;
+        } catch(const std::exception& e) {
+            spdlog::error("Failed to encode frame {} to {}: {}", frame.pts, output.string(), e.what());
+            failed = true;
+        }
+    }
+    // also after a failure, so the held back frames do not pile up
+    last_pts = std::max(last_pts, frame.pts);
+
+    std::lock_guard lock(mutex);
+    free_buffers.push_back(std::move(frame.pixels));
+}
+
+void video_capture::write(av::VideoFrame& frame) {
+    av::Packet packet = encoder.encode(frame);
+    if(packet) {
+        packet.setStreamIndex(stream.index());
+        octx.writePacket(packet);
+    }
+}
+
+}
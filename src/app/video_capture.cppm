@@ -0,0 +1,110 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+export module xmbshell.app:video_capture;
+
+import avcpp;
+import vma;
+import vulkan_hpp;
+
+namespace app {
+
+/* Encodes the rendered frames into a single video file (e.g. "--headless-encode out.webm").
+ * Every frame in flight copies its swapchain image into its own host-visible buffer. The copy is picked up
+ * the next time the same frame is rendered, when its fence has already been waited for, and handed to an encoder thread.
+ * A live capture never makes the render loop wait for the encoder: if it falls behind by more than max_queued_frames,
+ * frames are dropped, and so are frames that arrive after a newer one.
+ * Otherwise (with a fixed step per frame, see utils::clock) every frame belongs into the video, so the render loop waits
+ * for the encoder instead, and frames that arrive early are held back until the ones before them are there.
+ */
+export class video_capture {
+    public:
+        constexpr static std::size_t max_queued_frames = 16;
+
+        video_capture(vk::Device device, vma::Allocator allocator, vk::Extent2D extent, vk::Format format,
+            unsigned int frames, const std::filesystem::path& output, double fps, bool live);
+        // Waits for the outstanding copies, encodes everything still queued and finishes the file.
+        ~video_capture();
+
+        video_capture(const video_capture&) = delete;
+        video_capture& operator=(const video_capture&) = delete;
+
+        vk::Extent2D get_extent() const { return extent; }
+        unsigned int get_frame_count() const { return readbacks.size(); }
+
+        // Queues the copy recorded the last time "frame" was rendered. Its fence must have been waited for.
+        void collect(int frame);
+        // Records the copy of "image" (which is and stays in "layout") into the readback buffer of "frame".
+        void record(vk::CommandBuffer cmd, int frame, vk::Image image, vk::ImageLayout layout);
+    private:
+        struct readback {
+            vma::UniqueBuffer buffer;
+            vma::UniqueAllocation allocation;
+            std::optional<std::int64_t> pts;
+        };
+        struct queued_frame {
+            std::int64_t pts;
+            std::vector<std::uint8_t> pixels;
+        };
+
+        void encode_loop();
+        // Encodes "frame" unless encoding failed before, and gives its buffer back.
+        void encode(queued_frame& frame);
+        void write(av::VideoFrame& frame);
+
+        vk::Device device;
+        vma::Allocator allocator;
+        vk::Extent2D extent;
+        std::filesystem::path output;
+        std::vector<readback> readbacks;
+        std::int64_t next_pts = 0;
+        bool live;
+        unsigned int dropped_frames = 0;
+        // only touched by the encoder thread until it is joined
+        unsigned int out_of_order_frames = 0;
+        unsigned int encoded_frames = 0;
+        std::int64_t last_pts = -1;
+        std::map<std::int64_t, queued_frame> held_frames;
+        bool failed = false;
+
+        av::FormatContext octx;
+        av::VideoEncoderContext encoder;
+        av::Stream stream;
+        av::VideoRescaler rescaler;
+        av::PixelFormat source_format;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::condition_variable space; // notified when the encoder takes a frame out of the queue
+        std::deque<queued_frame> queue;
+        std::vector<std::vector<std::uint8_t>> free_buffers;
+        bool stopping = false;
+        std::thread encoder_thread;
+};
+
+}
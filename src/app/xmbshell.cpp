@@ -16,12 +16,16 @@
  */
 module;
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <typeinfo>
 #include <utility>
 #include <vector>
 #include <version>
@@ -37,18 +41,14 @@ import vma;
 import sdl2;
 import xmbshell.config;
 import xmbshell.render;
+import xmbshell.trace;
 import xmbshell.utils;
 
 using namespace mfk::i18n::literals;
 
 namespace app
 {
-    struct BlurConstants {
-        int axis = 0;
-        int size = 20;
-    };
-
-    xmbshell::xmbshell(window* window) : phase(window)
+    xmbshell::xmbshell(window* window) : phase(window), wake_event(sdl::RegisterEvents(1))
     {
     }
 
@@ -58,12 +58,15 @@ namespace app
 
     void xmbshell::preload()
     {
+        trace::scope span("preload");
         phase::preload();
 
         font_render = std::make_unique<font_renderer>(config::CONFIG.fontPath.string(), 32, device, allocator, win->swapchainExtent, win->gpuFeatures);
         image_render = std::make_unique<image_renderer>(device, win->swapchainExtent, win->gpuFeatures);
         simple_render = std::make_unique<simple_renderer>(device, allocator, win->swapchainExtent, win->gpuFeatures);
         wave_render = std::make_unique<render::wave_renderer>(device, allocator, win->swapchainExtent);
+        quad_render = std::make_unique<render::quad_renderer>(device, allocator);
+        icon_atlas = std::make_unique<render::icon_atlas>(device, allocator);
 
         {
             std::array<vk::AttachmentDescription, 2> attachments = {
@@ -91,7 +94,8 @@ namespace app
             backgroundRenderPass = device.createRenderPassUnique(renderpass_info);
             debugName(device, backgroundRenderPass.get(), "Background Render Pass");
         }
-        {
+        // resolves into the swapchain image, or into the source of the upscale pass when rendering at a lower resolution
+        auto create_shell_render_pass = [&](vk::ImageLayout finalLayout, std::string_view name) {
             std::array<vk::AttachmentDescription, 2> attachments = {
                 vk::AttachmentDescription({}, win->swapchainFormat.format, win->config.sampleCount,
                     vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare,
@@ -100,60 +104,66 @@ namespace app
                 vk::AttachmentDescription({}, win->swapchainFormat.format, vk::SampleCountFlagBits::e1,
                     vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eStore,
                     vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
-                    vk::ImageLayout::eUndefined, win->swapchainFinalLayout)
+                    vk::ImageLayout::eUndefined, finalLayout)
             };
             vk::AttachmentReference ref(0, vk::ImageLayout::eColorAttachmentOptimal);
             vk::AttachmentReference rref(1, vk::ImageLayout::eColorAttachmentOptimal);
             vk::SubpassDescription subpass({}, vk::PipelineBindPoint::eGraphics, {}, ref, rref);
-            vk::SubpassDependency dep(vk::SubpassExternal, 0,
-                vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eColorAttachmentOutput,
-                vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eColorAttachmentWrite);
-            vk::RenderPassCreateInfo renderpass_info({}, attachments, subpass, dep);
-            shellRenderPass = device.createRenderPassUnique(renderpass_info);
-            debugName(device, shellRenderPass.get(), "Shell Render Pass");
-        }
-        {
-            std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
-                vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
-                vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+            std::array<vk::SubpassDependency, 2> deps{
+                vk::SubpassDependency(vk::SubpassExternal, 0,
+                    vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                    vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eColorAttachmentWrite),
+                vk::SubpassDependency(0, vk::SubpassExternal,
+                    vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eFragmentShader,
+                    vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eShaderRead)
             };
-            vk::DescriptorSetLayoutCreateInfo info({}, bindings);
-            blurDescriptorSetLayout = device.createDescriptorSetLayoutUnique(info);
-        }
-        {
-            vk::PushConstantRange range{vk::ShaderStageFlagBits::eCompute, 0, sizeof(BlurConstants)};
-            vk::PipelineLayoutCreateInfo info({}, blurDescriptorSetLayout.get(), range);
-            blurPipelineLayout = device.createPipelineLayoutUnique(info);
-        }
-        {
-            vk::UniqueShaderModule compShader = render::shaders::blur::comp(device);
-            vk::PipelineShaderStageCreateInfo shader({}, vk::ShaderStageFlagBits::eCompute, compShader.get(), "main");
-            vk::ComputePipelineCreateInfo info({}, shader, blurPipelineLayout.get());
-            blurPipeline = device.createComputePipelineUnique({}, info).value;
-            debugName(device, blurPipeline.get(), "Blur Pipeline");
-        }
-
-        {
-            renderImage = std::make_unique<texture>(device, allocator,
-                win->swapchainExtent, vk::ImageUsageFlagBits::eColorAttachment,
-                win->swapchainFormat.format, win->config.sampleCount, false, vk::ImageAspectFlagBits::eColor);
-            debugName(device, renderImage->image, "Shell Render Image");
-
-            blurImageSrc = std::make_unique<texture>(device, allocator,
-                win->swapchainExtent, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-                vk::Format::eR16G16B16A16Sfloat, vk::SampleCountFlagBits::e1, false, vk::ImageAspectFlagBits::eColor);
-            debugName(device, blurImageSrc->image, "Blur Image Source");
-
-            blurImageDst = std::make_unique<texture>(device, allocator,
-                win->swapchainExtent, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-                vk::Format::eR16G16B16A16Sfloat, vk::SampleCountFlagBits::e1, false, vk::ImageAspectFlagBits::eColor);
-            debugName(device, blurImageDst->image, "Blur Image Destination");
+            // the frame only has to be ready for sampling if it is scaled up afterwards
+            std::span<const vk::SubpassDependency> dependencies = deps;
+            if(finalLayout != vk::ImageLayout::eShaderReadOnlyOptimal) {
+                dependencies = dependencies.first(1);
+            }
+            vk::RenderPassCreateInfo renderpass_info({}, attachments, subpass, dependencies);
+            auto renderPass = device.createRenderPassUnique(renderpass_info);
+            debugName(device, renderPass.get(), std::string(name));
+            return renderPass;
+        };
+        shellRenderPass = create_shell_render_pass(win->swapchainFinalLayout, "Shell Render Pass");
+        std::vector<vk::RenderPass> shellRenderPasses = {shellRenderPass.get()};
+        // rendering at a lower resolution needs its own variant of the render pass (and pipelines for it), so it is opt-in
+        if((config::CONFIG.adaptiveQuality && config::CONFIG.minRenderScale < 1.0) || config::CONFIG.fixedRenderScale) {
+            scaledShellRenderPass = create_shell_render_pass(vk::ImageLayout::eShaderReadOnlyOptimal, "Scaled Shell Render Pass");
+            shellRenderPasses.push_back(scaledShellRenderPass.get());
+            upscale = std::make_unique<render::upscale_pass>(device, allocator);
+            pipelines.submit("upscale", [this]{
+                upscale->preload(win->swapchainFormat.format, win->swapchainFinalLayout, win->pipelineCache.get());
+            });
         }
-
-        font_render->preload(loader, {shellRenderPass.get()}, win->config.sampleCount, win->pipelineCache.get(), nullptr, 0x20, 0x1ff);
-        image_render->preload({backgroundRenderPass.get(), shellRenderPass.get()}, win->config.sampleCount, win->pipelineCache.get());
-        simple_render->preload({shellRenderPass.get()}, win->config.sampleCount, win->pipelineCache.get());
-        wave_render->preload({backgroundRenderPass.get()}, win->config.sampleCount, win->pipelineCache.get());
+        std::vector<vk::RenderPass> allRenderPasses = shellRenderPasses;
+        allRenderPasses.insert(allRenderPasses.begin(), backgroundRenderPass.get());
+        // Every renderer creates its pipelines on its own thread, they are joined in prepare() right before they are needed.
+        pipelines.submit("font", [this, shellRenderPasses]{
+            font_render->preload(loader, shellRenderPasses, win->config.sampleCount, win->pipelineCache.get(), nullptr, 0x20, 0x1ff);
+        });
+        pipelines.submit("image", [this, allRenderPasses]{
+            image_render->preload(allRenderPasses, win->config.sampleCount, win->pipelineCache.get());
+        });
+        pipelines.submit("simple", [this, shellRenderPasses]{
+            simple_render->preload(shellRenderPasses, win->config.sampleCount, win->pipelineCache.get());
+        });
+        pipelines.submit("wave", [this, allRenderPasses]{
+            wave_render->preload(allRenderPasses, win->config.sampleCount, win->pipelineCache.get());
+        });
+        pipelines.submit("quad", [this, shellRenderPasses]{
+            quad_render->preload(shellRenderPasses, win->config.sampleCount, win->pipelineCache.get());
+        });
+        // not needed for the first frame, but built now so opening the first blur overlay or video does not stall
+        pipelines.submit("blur", [this]{
+            blur_pipelines = render::blur_pass::create_pipelines(device, win->pipelineCache.get());
+        });
+        yuv420p = std::make_unique<render::yuv420p_pipeline>(device);
+        pipelines.submit("yuv420p", [this]{
+            yuv420p->preload(win->pipelineCache.get());
+        });
 
         if(config::CONFIG.backgroundType == config::config::background_type::image) {
             backgroundTexture = std::make_unique<texture>(device, allocator);
@@ -176,300 +186,579 @@ namespace app
         config::CONFIG.addCallback("controller-type", [this](const std::string&){
             reload_button_icons();
         });
+        config::CONFIG.addCallback("font-path", [this](const std::string&){
+            text_layouts.invalidate();
+        });
+        config::CONFIG.addCallback("language", [this](const std::string&){
+            text_layouts.invalidate();
+        });
+        config::CONFIG.addCallback("*", [this](const std::string&){
+            mark_dirty(dirty_tracker::reason::content);
+        });
         config::CONFIG.addCallback("vsync", [this](const std::string&){
             spdlog::info("VSync changed to {}", config::CONFIG.preferredPresentMode == vk::PresentModeKHR::eFifoRelaxed ? "on" : "off");
             win->config.preferredPresentMode = config::CONFIG.preferredPresentMode;
             win->recreateSwapchain();
         });
 
-        if(!background_only) {
+        // Normally only the background is loaded before the first frame and the rest follows in load_next_stage().
+        // Benchmarks and scripts send input right away, so they get everything before the first frame.
+        // A capture is only created in prepare(), but it is already requested at this point.
+        stream_startup = !bench && !script && capture_output.empty();
+        if(!stream_startup && !background_only) {
+            preload_icons();
             preload_fixed_components();
         }
     }
 
+    void xmbshell::preload_icons()
+    {
+        trace::scope span("load icons");
+        ok_sound = sdl::mix::unique_chunk{sdl::mix::LoadWAV((config::CONFIG.asset_directory/"sounds/ok.wav").string().c_str())};
+        if(!ok_sound) {
+            spdlog::error("sdl::mix::LoadWAV: {}", sdl::mix::GetError());
+        }
+
+        reload_button_icons();
+
+        cursorTexture = std::make_unique<texture>(device, allocator);
+        loader->loadTexture(cursorTexture.get(), config::CONFIG.asset_directory/"icons/icon_cursor.png");
+        startup.mark(startup_timeline::stage::fonts);
+    }
+
     void xmbshell::preload_fixed_components()
     {
         if(fixed_components_loaded) {
             return;
         }
 
+        trace::scope span("load menus");
         menu.preload(device, allocator, *loader);
         news.preload(device, allocator, *loader);
+        fixed_components_loaded = true;
+        startup.mark(startup_timeline::stage::menus);
+    }
 
-        ok_sound = sdl::mix::unique_chunk{sdl::mix::LoadWAV((config::CONFIG.asset_directory/"sounds/ok.wav").string().c_str())};
-        if(!ok_sound) {
-            spdlog::error("sdl::mix::LoadWAV: {}", sdl::mix::GetError());
+    void xmbshell::load_next_stage()
+    {
+        if(background_only || fixed_components_loaded || !startup.reached(startup_timeline::stage::first_frame)) {
+            return;
         }
+        // one stage per frame, so the frames in between keep the background moving
+        if(!startup.reached(startup_timeline::stage::fonts)) {
+            if(!gui_renderers_ready && !prepare_gui_renderers(false)) {
+                return; // the pipelines are not done yet
+            }
+            preload_icons();
+        } else {
+            preload_fixed_components();
+        }
+        mark_dirty(dirty_tracker::reason::content);
+    }
 
-        reload_button_icons();
-
-        cursorTexture = std::make_unique<texture>(device, allocator);
-        loader->loadTexture(cursorTexture.get(), config::CONFIG.asset_directory/"icons/icon_cursor.png");
+    bool xmbshell::prepare_gui_renderers(bool wait)
+    {
+        if(!wait && (!pipelines.is_ready("font") || !pipelines.is_ready("simple"))) {
+            return false;
+        }
+        pipelines.wait("font");
+        font_render->prepare(swapchainImages.size());
+        pipelines.wait("simple");
+        simple_render->prepare(swapchainImages.size());
+        gui_renderers_ready = true;
+        return true;
     }
 
     void xmbshell::prepare(std::vector<vk::Image> swapchainImages, std::vector<vk::ImageView> swapchainViews)
     {
+        trace::scope span("prepare");
         phase::prepare(swapchainImages, swapchainViews);
 
         const unsigned int imageCount = swapchainImages.size();
+        this->swapchainImages = swapchainImages;
+        this->swapchainViews = swapchainViews;
+        stale_images.assign(imageCount, true);
+        startup.mark(startup_timeline::stage::window);
+
+        for(int i=0; i<imageCount; i++)
         {
-            vk::DescriptorPoolSize size(vk::DescriptorType::eStorageImage, 2*imageCount);
-            vk::DescriptorPoolCreateInfo pool_info({}, imageCount, size);
-            blurDescriptorPool = device.createDescriptorPoolUnique(pool_info);
+            debugName(device, swapchainImages[i], "Swapchain Image #"+std::to_string(i));
+        }
+        if(upscale) {
+            pipelines.wait("upscale");
+            upscale->prepare(swapchainViews, win->swapchainExtent);
+        }
+        create_render_targets();
 
-            std::vector<vk::DescriptorSetLayout> layouts(imageCount, blurDescriptorSetLayout.get());
-            vk::DescriptorSetAllocateInfo alloc_info(blurDescriptorPool.get(), layouts);
-            blurDescriptorSets = device.allocateDescriptorSets(alloc_info);
+        pipelines.wait("image");
+        image_render->prepare(swapchainViews.size());
+        pipelines.wait("wave");
+        wave_render->prepare(swapchainViews.size());
+        pipelines.wait("quad");
+        quad_render->prepare(swapchainViews.size());
+        icon_atlas->prepare(imageCount);
+        startup.mark(startup_timeline::stage::background);
+        // only needed once the menus are shown, so they are not waited for while streaming in the rest of the shell
+        gui_renderers_ready = false;
+        prepare_gui_renderers(!stream_startup);
+        // measured widths are relative to the frame, so they depend on its aspect ratio
+        text_layouts.invalidate();
+
+        gpu_timer = std::make_unique<render::gpu_timer>(device, win->physicalDevice, imageCount);
+        if(capture && (capture->get_extent() != win->swapchainExtent || capture->get_frame_count() != imageCount)) {
+            spdlog::warn("The swapchain changed, stopping the capture to {}", capture_output.string());
+            capture.reset();
+            capture_output.clear();
         }
-        this->swapchainImages = swapchainImages;
+        if(!capture && !capture_output.empty()) {
+            capture = std::make_unique<video_capture>(device, allocator, win->swapchainExtent, win->swapchainFormat.format,
+                imageCount, capture_output, capture_fps, !utils::clock::is_fixed_step());
+        }
+        mark_dirty(dirty_tracker::reason::content);
+    }
 
-        std::vector<vk::DescriptorImageInfo> imageInfos(2*imageCount);
-        std::vector<vk::WriteDescriptorSet> writes(imageCount);
+    void xmbshell::create_render_targets()
+    {
+        const unsigned int imageCount = swapchainImages.size();
+        renderExtent = win->swapchainExtent;
+        if(is_scaled()) {
+            renderExtent = vk::Extent2D(
+                std::max(1u, static_cast<unsigned int>(std::lround(win->swapchainExtent.width * render_scale))),
+                std::max(1u, static_cast<unsigned int>(std::lround(win->swapchainExtent.height * render_scale))));
+            upscale->resize(renderExtent);
+        }
 
+        // Every frame in flight gets its own intermediate images, so consecutive frames do not have to wait for each other.
         framebuffers.clear();
         backgroundFramebuffers.clear();
+        renderImages.clear();
         for(int i=0; i<imageCount; i++)
         {
-            debugName(device, swapchainImages[i], "Swapchain Image #"+std::to_string(i));
             {
-                std::array<vk::ImageView, 2> attachments = {renderImage->imageView.get(), swapchainViews[i]};
-                vk::FramebufferCreateInfo framebuffer_info({}, shellRenderPass.get(), attachments,
-                    win->swapchainExtent.width, win->swapchainExtent.height, 1);
+                auto& renderImage = renderImages.emplace_back(std::make_unique<texture>(device, allocator,
+                    renderExtent, vk::ImageUsageFlagBits::eColorAttachment,
+                    win->swapchainFormat.format, win->config.sampleCount, false, vk::ImageAspectFlagBits::eColor));
+                debugName(device, renderImage->image, "Shell Render Image #"+std::to_string(i));
+            }
+            // when scaled, the frame is resolved into the source of the upscale pass instead of the swapchain image
+            vk::ImageView target = is_scaled() ? upscale->get_image_view(i) : swapchainViews[i];
+            {
+                std::array<vk::ImageView, 2> attachments = {renderImages[i]->imageView.get(), target};
+                vk::FramebufferCreateInfo framebuffer_info({}, get_shell_render_pass(), attachments,
+                    renderExtent.width, renderExtent.height, 1);
                 framebuffers.push_back(device.createFramebufferUnique(framebuffer_info));
                 debugName(device, framebuffers.back().get(), "XMB Shell Framebuffer #"+std::to_string(i));
             }
             {
-                std::array<vk::ImageView, 2> attachments = {renderImage->imageView.get(), swapchainViews[i]};
+                std::array<vk::ImageView, 2> attachments = {renderImages[i]->imageView.get(), target};
                 vk::FramebufferCreateInfo framebuffer_info({}, backgroundRenderPass.get(), attachments,
-                    win->swapchainExtent.width, win->swapchainExtent.height, 1);
+                    renderExtent.width, renderExtent.height, 1);
                 backgroundFramebuffers.push_back(device.createFramebufferUnique(framebuffer_info));
                 debugName(device, backgroundFramebuffers.back().get(), "XMB Shell Background Framebuffer #"+std::to_string(i));
             }
+        }
 
-            imageInfos[2*i] = vk::DescriptorImageInfo({}, blurImageSrc->imageView.get(), vk::ImageLayout::eGeneral);
-            imageInfos[2*i+1] = vk::DescriptorImageInfo({}, blurImageDst->imageView.get(), vk::ImageLayout::eGeneral);
-            writes[i] = vk::WriteDescriptorSet(blurDescriptorSets[i], 0, 0, 2, vk::DescriptorType::eStorageImage, &imageInfos[2*i]);
+        // sized for the old render targets
+        background_layer.reset();
+        retired_background_layer.reset();
+
+        // only the targets depend on the size, the descriptor pool and pipelines are kept
+        if(backdrop_blur) {
+            backdrop_blur->resize(renderExtent, 2*imageCount);
+        } else {
+            backdrop_blur = std::make_unique<render::blur_pass>(device, allocator, renderExtent, 2*imageCount);
+            backdrop_blur->preload(get_blur_pipelines());
         }
-        device.updateDescriptorSets(writes, {});
+        backdrop_slot = 0;
+        cached_backdrop.reset();
+    }
 
-        font_render->prepare(swapchainViews.size());
-        image_render->prepare(swapchainViews.size());
-        simple_render->prepare(swapchainViews.size());
-        wave_render->prepare(swapchainViews.size());
+    bool xmbshell::needs_redraw(int frame) {
+        bool dirty_now = dirty.consume() != 0;
+
+        // The clock and the time dependent colors can change without anyone reporting it.
+        auto second = std::chrono::floor<std::chrono::seconds>(utils::clock::now());
+        if(second != last_rendered_second) {
+            last_rendered_second = second;
+            dirty_now = true;
+        }
+
+        if(dirty_now) {
+            std::ranges::fill(stale_images, true);
+        }
+        // The swapchain does not have to hand out its images in order (e.g. with mailbox or immediate present modes),
+        // so every image is re-recorded the next time it is acquired, until it holds the current state.
+        if(!stale_images[frame]) {
+            return false;
+        }
+        stale_images[frame] = false;
+        return true;
+    }
+
+    void xmbshell::wait_for_change() {
+        // scripted and measured runs go on at their own pace
+        if(awake || bench || script || capture || utils::clock::is_fixed_step()) {
+            return;
+        }
+        // the clock next to the menu has to show the next second in time
+        auto now = utils::clock::now();
+        auto timeout = std::chrono::ceil<std::chrono::milliseconds>(std::chrono::floor<std::chrono::seconds>(now) + std::chrono::seconds(1) - now);
+
+        trace::scope span("idle");
+        idle = true;
+        // a change reported before "idle" was set does not wake us up, so it has to be checked afterwards
+        if(!dirty.has_changes()) {
+            // only waits for the event, the window's loop takes it out of the queue and dispatches it afterwards
+            sdl::WaitEventTimeout(nullptr, static_cast<int>(timeout.count()));
+        }
+        idle = false;
+    }
+
+    void xmbshell::wake_up() {
+        sdl::Event event = {
+            .user = {
+                .type = wake_event,
+                .timestamp = sdl::GetTicks()
+            }
+        };
+        sdl::PushEvent(&event);
+    }
+
+    vk::ClearValue xmbshell::get_background_clear_color(const local_time& local_now) const {
+        if(ingame_mode) {
+            return vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.5f});
+        }
+        if(config::CONFIG.backgroundType == config::config::background_type::color ||
+            config::CONFIG.backgroundType == config::config::background_type::wave)
+        {
+            auto c = std::visit([&](auto&& c){
+                return c.get(local_now);
+            }, config::CONFIG.backgroundColor);
+            return vk::ClearColorValue(std::array<float, 4>{c.r, c.g, c.b, 1.0f});
+        }
+        return vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f});
+    }
+
+    void xmbshell::render_background(vk::CommandBuffer commandBuffer, int frame, vk::RenderPass renderPass, const local_time& local_now) {
+        if(ingame_mode) {
+            return;
+        }
+        if(config::CONFIG.backgroundType == config::config::background_type::wave) {
+            wave_render->waveColor = std::visit([&](auto&& c){
+                return c.get(local_now);
+            }, config::CONFIG.waveColor);
+            auto timer = gpu_timer->measure(commandBuffer, "wave");
+            wave_render->render(commandBuffer, frame, renderPass, utils::clock::now() - start_time);
+            if(wave_render->is_animated()) {
+                mark_dirty(dirty_tracker::reason::animation);
+            }
+        }
+        else if(config::CONFIG.backgroundType == config::config::background_type::image) {
+            if(backgroundTexture) {
+                if(!backgroundTexture->loaded) {
+                    mark_dirty(dirty_tracker::reason::content);
+                }
+                image_render->renderImageSized(commandBuffer, frame, renderPass, *backgroundTexture,
+                    0.0f, 0.0f,
+                    static_cast<int>(win->swapchainExtent.width),
+                    static_cast<int>(win->swapchainExtent.height)
+                );
+            }
+        }
+    }
+
+    bool xmbshell::update_background_layer(vk::CommandBuffer commandBuffer, int frame, const local_time& local_now) {
+        const float scale = std::min(static_cast<float>(config::CONFIG.backgroundScale), governor.get().background_scale);
+        const int rate = config::CONFIG.backgroundRate;
+        // only the wave is worth it, the other backgrounds are (almost) free to draw
+        const bool wanted = config::CONFIG.backgroundType == config::config::background_type::wave && !ingame_mode &&
+            (scale < 1.0f || rate > 0);
+        if(!wanted || (background_layer && background_layer->get_scale() != scale)) {
+            retire_background_layer();
+        }
+        if(!wanted) {
+            return false;
+        }
+        if(!background_layer) {
+            background_layer = std::make_unique<render::background_layer>(device, allocator, backgroundRenderPass.get(),
+                renderExtent, win->swapchainFormat.format, win->config.sampleCount, scale, swapchainImages.size());
+            spdlog::debug("Rendering the background at {}x{}", background_layer->get_extent().width, background_layer->get_extent().height);
+        }
+
+        auto now = utils::clock::now();
+        const bool due = !background_layer->has_result() || rate <= 0 ||
+            now - last_background_update >= std::chrono::duration<double>(1.0 / rate);
+        if(!due) {
+            if(wave_render->is_animated()) {
+                mark_dirty(dirty_tracker::reason::animation);
+            }
+            return true;
+        }
+        auto timer = gpu_timer->measure(commandBuffer, "background layer");
+        background_layer->begin(commandBuffer, frame, backgroundRenderPass.get(), get_background_clear_color(local_now));
+        render_background(commandBuffer, frame, backgroundRenderPass.get(), local_now);
+        background_layer->end(commandBuffer, frame);
+        last_background_update = now;
+        return true;
+    }
+
+    void xmbshell::retire_background_layer() {
+        if(!background_layer) {
+            return;
+        }
+        // frames in flight might still show it
+        if(retired_background_layer) {
+            device.waitIdle();
+        }
+        retired_background_layer = std::move(background_layer);
+        retired_background_layer_frames = swapchainImages.size();
+    }
+
+    std::optional<xmbshell::backdrop_key> xmbshell::get_backdrop_key(const local_time& local_now) const {
+        if(config::CONFIG.backgroundType == config::config::background_type::wave && wave_render->is_animated() && !ingame_mode) {
+            return std::nullopt; // changes every frame anyway
+        }
+        auto get = [&](auto& color) {
+            return std::visit([&](auto&& c){
+                return c.get(local_now);
+            }, color);
+        };
+        return backdrop_key{
+            .type = config::CONFIG.backgroundType,
+            .color = get(config::CONFIG.backgroundColor),
+            .wave_color = get(config::CONFIG.waveColor),
+            .image = backgroundTexture.get(),
+            .image_loaded = backgroundTexture && backgroundTexture->loaded,
+            .ingame = ingame_mode,
+        };
     }
 
     void xmbshell::render(int frame, vk::Semaphore imageAvailable, vk::Semaphore renderFinished, vk::Fence fence)
     {
-        tick();
+        trace::scope span("frame");
+        const auto cpu_start = std::chrono::steady_clock::now();
+        // nothing allocated for the previous frame is used anymore
+        arena.reset();
+        if(retired_background_layer && retired_background_layer_frames-- == 0) {
+            retired_background_layer.reset();
+        }
+        // the timers of the previous frame have all finished by now
+        profiler.end_frame();
+        utils::clock::advance();
+        if(bench && !bench->frame(this)) {
+            benchmark_failed = bench->has_failed();
+            bench.reset();
+        }
+        if(script) {
+            script->frame(this);
+        }
+        profiler.set_enabled(config::CONFIG.showPerformance || bench);
+        auto frame_timer = profiler.scope("frame");
+        if(capture) {
+            capture->collect(frame);
+        }
+
+        {
+            auto timer = profiler.scope("tick");
+            trace::scope span("tick");
+            awake = false;
+            tick();
+        }
+
+        // Instead of presenting the same image at the frame rate limit, the loop sleeps until something could have changed.
+        // Changes reported from other threads (D-Bus, settings) are rendered right away,
+        // input is dispatched by the window's loop first and rendered with the next frame.
+        bool redraw = needs_redraw(frame) || !config::CONFIG.onDemandRendering;
+        if(!redraw) {
+            wait_for_change();
+            redraw = needs_redraw(frame);
+        }
+        if(!redraw) {
+            // Nothing changed, so the swapchain image still holds the last frame and we only need to present it again.
+            vk::PipelineStageFlags waitFlags = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+            vk::SubmitInfo submit_info(imageAvailable, waitFlags, {}, renderFinished);
+            graphicsQueue.submit(submit_info, fence);
+            return;
+        }
 
+        text_layouts.begin_frame();
         vk::CommandBuffer commandBuffer = commandBuffers[frame];
-        auto now = std::chrono::system_clock::now();
+        auto now = utils::clock::now();
         auto local_now = get_local_time();
 
+        if(upscale && pending_render_scale != render_scale) {
+            // rare enough to simply wait for the frames in flight instead of keeping the old targets alive
+            trace::scope span("change render scale");
+            device.waitIdle();
+            render_scale = pending_render_scale;
+            create_render_targets();
+        }
+        if(const unsigned int downscale = governor.get().blur_downscale; backdrop_blur->get_downscale() != downscale) {
+            // releases all blur targets, so it has to wait just like a change of the render scale
+            trace::scope span("change blur resolution");
+            device.waitIdle();
+            backdrop_blur->set_downscale(downscale);
+            cached_backdrop.reset();
+        }
+
+        auto record_timer = profiler.scope("record");
         commandBuffer.begin(vk::CommandBufferBeginInfo());
+        gpu_timer->begin_frame(commandBuffer, frame, config::CONFIG.showFPS || config::CONFIG.adaptiveQuality || bench);
+        auto gpu_frame_timer = gpu_timer->measure(commandBuffer, "frame");
+        if(icon_atlas->has_pending_uploads()) {
+            trace::scope span("upload icons");
+            icon_atlas->record_uploads(commandBuffer, frame);
+            if(icon_atlas->has_pending_uploads()) {
+                // the rest of them did not fit into this frame's budget
+                mark_dirty(dirty_tracker::reason::content);
+            }
+        }
         for(auto& overlay : std::views::reverse(overlays)) {
+            auto timer = profiler.scope("prerender ", *overlay);
+            trace::scope span("prerender", typeid(*overlay));
+            auto gpu_scope = gpu_timer->measure(commandBuffer,
+                gpu_timer->is_enabled() ? profiler.type_name("prerender ", typeid(*overlay)) : std::string_view{});
             overlay->prerender(commandBuffer, frame, this);
         }
-        {
-            vk::ClearValue color(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f});
-            if(config::CONFIG.backgroundType == config::config::background_type::color ||
-                config::CONFIG.backgroundType == config::config::background_type::wave)
-            {
-                auto c = std::visit([&](auto&& c){
-                    return c.get(local_now);
-                }, config::CONFIG.backgroundColor);
-                color = vk::ClearColorValue(std::array<float, 4>{c.r, c.g, c.b, 1.0f});
-            }
-            if(ingame_mode) {
-                color = vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.5f});
-            }
+        double blur_background_progress = utils::progress(now, last_blur_background_change, blur_background_transition_duration);
+        if(blur_background_progress < 1.0) {
+            mark_dirty(dirty_tracker::reason::animation);
+        }
+        // Only the blur needs the background as a separate image, otherwise we can draw it directly in the shell render pass.
+        const bool needs_backdrop = blur_background || blur_background_progress < 1.0;
+        auto backdrop = needs_backdrop ? get_backdrop_key(local_now) : std::nullopt;
+        // an animated backdrop changes every frame, but it is blurred anyway, so the governor may reuse it for a few frames
+        const bool backdrop_outdated = backdrop ? backdrop != cached_backdrop :
+            cached_backdrop || backdrop_age + 1 >= governor.get().backdrop_interval || !backdrop_blur->is_allocated(backdrop_slot);
+        backdrop_age++;
+        if(needs_backdrop && backdrop_outdated) {
+            auto background_timer = gpu_timer->measure(commandBuffer, "background");
             commandBuffer.beginRenderPass(vk::RenderPassBeginInfo(backgroundRenderPass.get(), backgroundFramebuffers[frame].get(),
-                vk::Rect2D({0, 0}, win->swapchainExtent), color), vk::SubpassContents::eInline);
+                vk::Rect2D({0, 0}, renderExtent), get_background_clear_color(local_now)), vk::SubpassContents::eInline);
             vk::Viewport viewport(0.0f, 0.0f,
-                static_cast<float>(win->swapchainExtent.width),
-                static_cast<float>(win->swapchainExtent.height), 0.0f, 1.0f);
-            vk::Rect2D scissor({0,0}, win->swapchainExtent);
+                static_cast<float>(renderExtent.width),
+                static_cast<float>(renderExtent.height), 0.0f, 1.0f);
+            vk::Rect2D scissor({0,0}, renderExtent);
             commandBuffer.setViewport(0, viewport);
             commandBuffer.setScissor(0, scissor);
 
-            if(!ingame_mode) {
-                if(config::CONFIG.backgroundType == config::config::background_type::wave) {
-                    wave_render->waveColor = std::visit([&](auto&& c){
-                        return c.get(local_now);
-                    }, config::CONFIG.waveColor);
-                    wave_render->render(commandBuffer, frame, backgroundRenderPass.get());
-                }
-                else if(config::CONFIG.backgroundType == config::config::background_type::image) {
-                    if(backgroundTexture) {
-                        image_render->renderImageSized(commandBuffer, frame, backgroundRenderPass.get(), *backgroundTexture,
-                            0.0f, 0.0f,
-                            static_cast<int>(win->swapchainExtent.width),
-                            static_cast<int>(win->swapchainExtent.height)
-                        );
-                    }
-                }
-            }
+            render_background(commandBuffer, frame, backgroundRenderPass.get(), local_now);
 
             commandBuffer.endRenderPass();
+            background_timer.stop();
+
+            // blur into this frame's own slot, so frames that still show the previous backdrop are not disturbed
+            auto blur_timer = gpu_timer->measure(commandBuffer, "blur");
+            backdrop_blur->record(commandBuffer, frame, get_render_image(frame), vk::ImageLayout::eShaderReadOnlyOptimal,
+                vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::AccessFlagBits::eColorAttachmentWrite);
+            backdrop_slot = frame;
+            backdrop_age = 0;
+            cached_backdrop = backdrop;
         }
-        double blur_background_progress = utils::progress(now, last_blur_background_change, blur_background_transition_duration);
-        if(blur_background || blur_background_progress < 1.0) {
-            commandBuffer.pipelineBarrier(
-                vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
-                {}, {}, {},
-                {
-                    vk::ImageMemoryBarrier(
-                        {}, vk::AccessFlagBits::eTransferRead,
-                        vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
-                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                        swapchainImages[frame], vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                    vk::ImageMemoryBarrier(
-                        {}, vk::AccessFlagBits::eTransferWrite,
-                        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
-                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                        blurImageSrc->image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                }
-            );
-
-            commandBuffer.blitImage(swapchainImages[frame], vk::ImageLayout::eTransferSrcOptimal,
-                blurImageSrc->image, vk::ImageLayout::eTransferDstOptimal,
-                vk::ImageBlit(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
-                    {vk::Offset3D(0, 0, 0), vk::Offset3D(static_cast<int>(win->swapchainExtent.width), static_cast<int>(win->swapchainExtent.height), 1)},
-                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1), {vk::Offset3D(0, 0, 0), vk::Offset3D(blurImageSrc->width, blurImageSrc->height, 1)}),
-                vk::Filter::eLinear);
-
-            commandBuffer.pipelineBarrier(
-                vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
-                {}, {}, {},
-                {
-                    vk::ImageMemoryBarrier(
-                        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
-                        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eGeneral,
-                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                        blurImageSrc->image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                    vk::ImageMemoryBarrier(
-                        {}, vk::AccessFlagBits::eShaderWrite,
-                        vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
-                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                        blurImageDst->image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                }
-            );
-
-            int groupCountX = static_cast<int>(std::ceil(blurImageSrc->width/16.0));
-            int groupCountY = static_cast<int>(std::ceil(blurImageSrc->height/16.0));
-
-            BlurConstants constants{};
-            constants.size = static_cast<int>(20 * (blur_background ? blur_background_progress : (1.0 - blur_background_progress)));
-            commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, blurPipeline.get());
-            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, blurPipelineLayout.get(), 0, {blurDescriptorSets[frame]}, {});
-
-            constants.axis = 0;
-            commandBuffer.pushConstants(blurPipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(BlurConstants), &constants);
-            commandBuffer.dispatch(groupCountX, groupCountY, 1);
-
-            // TODO: THIS IS WRONG! We need to copy dst -> src with appropriate barriers (see blur_layer)
-            // But it kinda work, so I'll leave it for now
-
-            constants.axis = 1;
-            commandBuffer.pushConstants(blurPipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(BlurConstants), &constants);
-            commandBuffer.dispatch(groupCountX, groupCountY, 1);
-
-            commandBuffer.pipelineBarrier(
-                vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader,
-                {}, {}, {},
-                {
-                    vk::ImageMemoryBarrier(
-                        vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
-                        vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
-                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                        blurImageDst->image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                }
-            );
-        }
-        else {
-            commandBuffer.pipelineBarrier(
-                vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
-                {}, {}, {},
-                {
-                    vk::ImageMemoryBarrier(
-                        {}, vk::AccessFlagBits::eTransferRead,
-                        vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
-                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                        swapchainImages[frame], vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                    vk::ImageMemoryBarrier(
-                        {}, vk::AccessFlagBits::eTransferWrite,
-                        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
-                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                        blurImageDst->image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                }
-            );
-
-            commandBuffer.blitImage(swapchainImages[frame], vk::ImageLayout::eTransferSrcOptimal,
-                blurImageDst->image, vk::ImageLayout::eTransferDstOptimal,
-                vk::ImageBlit(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
-                    {vk::Offset3D(0, 0, 0), vk::Offset3D(static_cast<int>(win->swapchainExtent.width), static_cast<int>(win->swapchainExtent.height), 1)},
-                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1), {vk::Offset3D(0, 0, 0), vk::Offset3D(blurImageDst->width, blurImageDst->height, 1)}),
-                vk::Filter::eLinear);
-
-            commandBuffer.pipelineBarrier(
-                vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
-                {}, {}, {},
-                {
-                    vk::ImageMemoryBarrier(
-                        vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
-                        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
-                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                        blurImageDst->image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                }
-            );
-            /*commandBuffer.pipelineBarrier(
-                vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eColorAttachmentOutput,
-                {}, {}, {},
-                {
-                    vk::ImageMemoryBarrier(
-                        vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eColorAttachmentWrite,
-                        vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eColorAttachmentOptimal,
-                        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
-                        swapchainImages[frame], vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-                    ),
-                }
-            );*/
+        // the slot holding the cached backdrop is kept while it is shown
+        backdrop_blur->release_if_idle(needs_backdrop ? std::optional<unsigned int>(backdrop_slot) : std::nullopt);
+        if(!backdrop_blur->is_allocated(backdrop_slot)) {
+            cached_backdrop.reset();
         }
+        const double blur_strength = blur_background ? blur_background_progress : 1.0 - blur_background_progress;
+        const bool use_background_layer = blur_strength < 1.0 && update_background_layer(commandBuffer, frame, local_now);
+        bool gui_rendered = false;
         {
-            vk::ClearValue color(std::array<float, 4>{0.0f, 0.0f, 0.0f, 0.0f});
-            commandBuffer.beginRenderPass(vk::RenderPassBeginInfo(shellRenderPass.get(), framebuffers[frame].get(),
-                vk::Rect2D({0, 0}, win->swapchainExtent), color), vk::SubpassContents::eInline);
-            vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(win->swapchainExtent.width), static_cast<float>(win->swapchainExtent.height), 0.0f, 1.0f);
-            vk::Rect2D scissor({0,0}, win->swapchainExtent);
+            auto timer = gpu_timer->measure(commandBuffer, "shell");
+            vk::ClearValue color = get_background_clear_color(local_now);
+            commandBuffer.beginRenderPass(vk::RenderPassBeginInfo(get_shell_render_pass(), framebuffers[frame].get(),
+                vk::Rect2D({0, 0}, renderExtent), color), vk::SubpassContents::eInline);
+            vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f);
+            vk::Rect2D scissor({0,0}, renderExtent);
             commandBuffer.setViewport(0, viewport);
             commandBuffer.setScissor(0, scissor);
 
-            image_render->renderImageSized(commandBuffer, frame, shellRenderPass.get(), blurImageDst->imageView.get(),
-                0.0f, 0.0f, static_cast<int>(win->swapchainExtent.width), static_cast<int>(win->swapchainExtent.height));
+            // sized like the framebuffer, so the scissors of clipped draws (set_clip, draw_list) land on the right pixels
+            gui_renderer ctx(commandBuffer, frame, get_shell_render_pass(), renderExtent, font_render.get(), image_render.get(), simple_render.get());
+            if(use_background_layer) {
+                ctx.draw_image(background_layer->get_result(), 0.0f, 0.0f, static_cast<float>(ctx.aspect_ratio), 1.0f);
+            } else if(blur_strength < 1.0) {
+                render_background(commandBuffer, frame, get_shell_render_pass(), local_now);
+            }
+            if(needs_backdrop) {
+                // fade the (always fully) blurred background in and out
+                ctx.push_color(glm::vec4(1.0f, 1.0f, 1.0f, static_cast<float>(blur_strength)));
+                ctx.draw_image(backdrop_blur->get_result(backdrop_slot), 0.0f, 0.0f, static_cast<float>(ctx.aspect_ratio), 1.0f);
+                ctx.pop_color();
+            }
 
-            gui_renderer ctx(commandBuffer, frame, shellRenderPass.get(), win->swapchainExtent, font_render.get(), image_render.get(), simple_render.get());
-            if(!background_only) {
+            if(!background_only && fixed_components_loaded) {
                 render_gui(ctx);
+                gui_rendered = true;
             }
 
             commandBuffer.endRenderPass();
         }
-        font_render->finish(frame);
+        if(gui_renderers_ready) {
+            font_render->finish(frame);
+            simple_render->finish(frame);
+        }
         image_render->finish(frame);
-        simple_render->finish(frame);
+        quad_render->finish(frame);
+        if(is_scaled()) {
+            auto timer = gpu_timer->measure(commandBuffer, "upscale");
+            upscale->record(commandBuffer, frame, static_cast<float>(config::CONFIG.renderSharpness));
+        }
+        if(capture) {
+            capture->record(commandBuffer, frame, swapchainImages[frame], win->swapchainFinalLayout);
+        }
+        gpu_frame_timer.stop();
         commandBuffer.end();
+        record_timer.stop();
 
-        vk::PipelineStageFlags waitFlags = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-        vk::SubmitInfo submit_info(imageAvailable, waitFlags, commandBuffer, renderFinished);
-        graphicsQueue.submit(submit_info, fence);
+        {
+            auto submit_timer = profiler.scope("submit");
+            trace::scope span("submit");
+            vk::PipelineStageFlags waitFlags = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+            vk::SubmitInfo submit_info(imageAvailable, waitFlags, commandBuffer, renderFinished);
+            graphicsQueue.submit(submit_info, fence);
+        }
+        startup.mark(startup_timeline::stage::first_frame);
+        if(gui_rendered) {
+            startup.mark(startup_timeline::stage::interactive);
+        }
+
+        update_quality(std::chrono::steady_clock::now() - cpu_start);
+    }
+
+    void xmbshell::update_quality(std::chrono::duration<double> cpu_time) {
+        // benchmarks and captures should not depend on how fast the machine happens to be
+        if(!config::CONFIG.adaptiveQuality || bench || capture) {
+            if(governor.get_level() != 0) {
+                governor.reset();
+                wave_render->set_grid_quality(governor.get().wave_grid);
+            }
+            resolution.reset();
+            pending_render_scale = static_cast<float>(config::CONFIG.fixedRenderScale.value_or(resolution.get_scale()));
+            return;
+        }
+        // frames are only as fast as the slower of CPU and GPU
+        auto gpu_time = std::chrono::duration<double, std::milli>(gpu_timer->get_milliseconds("frame").value_or(0.0));
+        auto budget = config::CONFIG.frameTime > std::chrono::duration<double>::zero() ?
+            config::CONFIG.frameTime : std::chrono::duration<double>(1.0/60.0);
+        if(governor.frame(std::max<std::chrono::duration<double>>(cpu_time, gpu_time), budget)) {
+            const auto& level = governor.get();
+            spdlog::info("Quality level {}/{}: wave grid {}, blurring an animated background every {} frame(s), background scale {}, blur at 1/{}",
+                governor.get_level(), quality_governor::levels.size()-1,
+                render::wave_renderer::grid_qualities[level.wave_grid], level.backdrop_interval, level.background_scale,
+                2u << level.blur_downscale);
+            wave_render->set_grid_quality(level.wave_grid);
+        }
+        if(config::CONFIG.fixedRenderScale) {
+            pending_render_scale = static_cast<float>(*config::CONFIG.fixedRenderScale);
+            return;
+        }
+        // only the GPU gets faster with fewer pixels
+        if(upscale && resolution.frame(gpu_time, budget, static_cast<float>(config::CONFIG.minRenderScale))) {
+            spdlog::info("Render scale {}", resolution.get_scale());
+            pending_render_scale = resolution.get_scale();
+            mark_dirty(dirty_tracker::reason::content);
+        }
     }
 
     void xmbshell::render_gui(gui_renderer& renderer) {
@@ -487,25 +776,32 @@ namespace app
             }
         }
 
-        auto now = std::chrono::system_clock::now();
+        auto now = utils::clock::now();
         // TODO: somehow fix this.... god this is gonna be a huge mess
         double overlay_progress = utils::progress(now, overlay_fade_time, overlay_transition_duration);
         double dir_progress = overlay_fade_direction == transition_direction::in ? overlay_progress : 1.0 - overlay_progress;
         bool overlay_transition = overlay_progress < 1.0;
+        if(overlay_transition) {
+            mark_dirty(dirty_tracker::reason::animation);
+        }
         if(render_menu){
             if(overlay_transition || has_overlay) {
                 constexpr glm::vec4 factor{0.25f, 0.25f, 0.25f, 1.0f};
-                renderer.push_color(glm::mix(glm::vec4(1.0), factor, dir_progress));
+                push_gui_color(renderer, glm::mix(glm::vec4(1.0), factor, dir_progress));
+            }
+            {
+                auto timer = profiler.scope("main_menu::render");
+                trace::scope span("render", typeid(menu));
+                menu.render(renderer);
             }
-            menu.render(renderer);
 
             auto local_now = get_local_time();
-            renderer.draw_text(std::vformat("{:"+config::CONFIG.dateTimeFormat+"}", std::make_format_args(local_now)),
+            renderer.draw_text(get_clock_text(local_now),
                 static_cast<float>(0.831770833f+config::CONFIG.dateTimeOffset), 0.086111111f, 0.021296296f*2.5f);
 
             news.render(renderer);
             if(overlay_transition || has_overlay) {
-                renderer.pop_color();
+                pop_gui_color(renderer);
             }
             /*if(choice_overlay || choice_overlay_progress < 1.0) {
                 renderer.pop_color();
@@ -520,19 +816,21 @@ namespace app
         bool enable_cursor = false;
         for(unsigned int i=overlay_begin; i < overlays.size(); i++) {
             // TODO: support darkening overlays on top of overlays (i.e. a choice_overlay over a message_overlay)
+            auto timer = profiler.scope("render ", *overlays[i]);
+            trace::scope span("render", typeid(*overlays[i]));
             if(i == overlays.size()-1 && overlay_transition) {
-                renderer.push_color(glm::mix(glm::vec4(0.0), glm::vec4(1.0), dir_progress));
+                push_gui_color(renderer, glm::mix(glm::vec4(0.0), glm::vec4(1.0), dir_progress));
                 overlays[i]->render(renderer, this);
-                renderer.pop_color();
+                pop_gui_color(renderer);
             } else {
                 overlays[i]->render(renderer, this);
             }
             enable_cursor = overlays[i]->enable_cursor(); // only the topmost overlay controls the visibility of the cursor
         }
         if(overlay_transition && overlay_fade_direction == transition_direction::out && old_overlay) {
-            renderer.push_color(glm::mix(glm::vec4(0.0), glm::vec4(1.0), dir_progress));
+            push_gui_color(renderer, glm::mix(glm::vec4(0.0), glm::vec4(1.0), dir_progress));
             old_overlay->render(renderer, this);
-            renderer.pop_color();
+            pop_gui_color(renderer);
         } else if(old_overlay) {
             old_overlay.reset();
         }
@@ -547,8 +845,12 @@ namespace app
 
         float debug_y = 0.0;
         if(config::CONFIG.showFPS) {
-            renderer.draw_text("FPS: {:.2f}"_(win->currentFPS), 0, debug_y, 0.05f, glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
+            renderer.draw_text(arena.vformat(std::string_view{"FPS: {:.2f}"_}, std::make_format_args(win->currentFPS)), 0, debug_y, 0.05f, glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
             debug_y += 0.025f;
+            for(const auto& r : gpu_timer->get_results()) {
+                renderer.draw_text(arena.vformat(std::string_view{"GPU {}: {:.2f} ms"_}, std::make_format_args(r.name, r.milliseconds)), 0, debug_y, 0.05f, glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
+                debug_y += 0.025f;
+            }
         }
         if(config::CONFIG.showMemory) {
             vk::DeviceSize budget{}, usage{};
@@ -559,18 +861,27 @@ namespace app
             constexpr double mb = 1024.0*1024.0;
             auto u = static_cast<double>(usage)/mb;
             auto b = static_cast<double>(budget)/mb;
-            renderer.draw_text("Video Memory: {:.2f}/{:.2f} MB"_(u, b), 0, debug_y, 0.05f, glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
+            renderer.draw_text(arena.vformat(std::string_view{"Video Memory: {:.2f}/{:.2f} MB"_}, std::make_format_args(u, b)), 0, debug_y, 0.05f, glm::vec4(0.7f, 0.7f, 0.7f, 1.0f));
             debug_y += 0.025f;
         }
+        if(config::CONFIG.showPerformance) {
+            // keep rendering, otherwise the graphs would freeze
+            mark_dirty(dirty_tracker::reason::animation);
+            auto list = make_draw_list(renderer);
+            debug_y = perf.render(list, debug_y);
+        }
     }
 
     void xmbshell::reload_background() {
+        cached_backdrop.reset();
+        mark_dirty(dirty_tracker::reason::content);
         if(config::CONFIG.backgroundType == config::config::background_type::image) {
             backgroundTexture = std::make_unique<texture>(device, allocator);
             loader->loadTexture(backgroundTexture.get(), config::CONFIG.backgroundImage);
         }
     }
     void xmbshell::reload_button_icons() {
+        mark_dirty(dirty_tracker::reason::content);
         auto controller_type = get_controller_type();
 
         for(std::underlying_type_t<action> i = std::to_underlying(action::none)+1; i < std::to_underlying(action::_length); i++) {
@@ -582,6 +893,9 @@ namespace app
             std::string_view name = utils::enum_name(a);
             std::filesystem::path icon_name = config::CONFIG.asset_directory / "icons" / std::format("icon_button_{}_{}.png", controller_type, name);
 
+            if(buttonTextures[i]) {
+                render::quad_renderer::forget(buttonTextures[i]->imageView.get());
+            }
             buttonTextures[i] = std::make_unique<texture>(device, allocator);
             loader->loadTexture(buttonTextures[i].get(), icon_name);
         }
@@ -612,32 +926,45 @@ namespace app
     }
 
     void xmbshell::tick() {
+        load_next_stage();
         if(background_only) {
             return;
         }
 
+        if(last_controller_axis_input[0] || last_controller_axis_input[1] || last_controller_button_input) {
+            // held inputs repeat without any new events
+            stay_awake();
+        }
         for(unsigned int i=0; i<2; i++) {
             if(last_controller_axis_input[i]) {
-                auto time_since_input = std::chrono::duration<double>(std::chrono::system_clock::now() - last_controller_axis_input_time[i]);
+                auto time_since_input = std::chrono::duration<double>(utils::clock::now() - last_controller_axis_input_time[i]);
                 if(time_since_input > controller_axis_input_duration) {
                     auto [controller, dir] = *last_controller_axis_input[i];
                     dispatch<events::joystick_axis>(dir, i,
                         controller_axis_position[i].x,
                         controller_axis_position[i].y);
-                    last_controller_axis_input_time[i] = std::chrono::system_clock::now();
+                    last_controller_axis_input_time[i] = utils::clock::now();
                 }
             }
         }
         if(last_controller_button_input) {
-            auto time_since_input = std::chrono::duration<double>(std::chrono::system_clock::now() - last_controller_button_input_time);
+            auto time_since_input = std::chrono::duration<double>(utils::clock::now() - last_controller_button_input_time);
             if(time_since_input > controller_button_input_duration) {
                 auto [controller, button] = *last_controller_button_input;
                 button_down(controller, button);
             }
         }
 
+        menu.tick();
         for(unsigned int i=0; i<overlays.size(); i++) {
-            auto res = overlays[i]->tick(this);
+            auto res = [&]{
+                auto timer = profiler.scope("tick ", *overlays[i]);
+                trace::scope span("tick", typeid(*overlays[i]));
+                return overlays[i]->tick(this);
+            }();
+            if(overlays[i]->is_animated()) {
+                mark_dirty(dirty_tracker::reason::animation);
+            }
             if(res & result::close) {
                 remove_overlay(i);
                 i--;
@@ -648,7 +975,8 @@ namespace app
     }
 
     void xmbshell::dispatch(const event& event) {
-        if(background_only) {
+        mark_dirty(dirty_tracker::reason::input);
+        if(background_only || !fixed_components_loaded) {
             return;
         }
 
@@ -745,7 +1073,7 @@ namespace app
     {
         spdlog::trace("Button down: {}", fmt::underlying(button));
         last_controller_button_input = std::make_tuple(controller, button);
-        last_controller_button_input_time = std::chrono::system_clock::now();
+        last_controller_button_input_time = utils::clock::now();
 
         switch (button) {
             case sdl::GameControllerButtonValues::DPAD_LEFT:
@@ -826,7 +1154,7 @@ namespace app
             unsigned int index = axis == sdl::GameControllerAxisValues::LEFTX ? 0 : 1;
             if(std::abs(value) < controller_axis_input_threshold) {
                 last_controller_axis_input[index] = std::nullopt;
-                last_controller_axis_input_time[index] = std::chrono::system_clock::now();
+                last_controller_axis_input_time[index] = utils::clock::now();
 
                 default_dispatch();
                 return;
@@ -841,7 +1169,7 @@ namespace app
                 controller_axis_position[index].x,
                 controller_axis_position[index].y);
             last_controller_axis_input[index] = std::make_tuple(controller, dir);
-            last_controller_axis_input_time[index] = std::chrono::system_clock::now();
+            last_controller_axis_input_time[index] = utils::clock::now();
         } else {
             default_dispatch();
         }
@@ -16,19 +16,27 @@
  */
 module;
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <filesystem>
+#include <format>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
 
 export module xmbshell.app:main;
 
+import xmbshell.config;
 import xmbshell.constants;
 import xmbshell.render;
 import xmbshell.utils;
@@ -39,11 +47,22 @@ import spdlog;
 import vulkan_hpp;
 
 import :component;
+import :benchmark;
+import :dirty_tracker;
+import :frame_arena;
+import :frame_profiler;
+import :input_script;
 import :choice_overlay;
 import :main_menu;
 import :message_overlay;
 import :news_display;
+import :perf_hud;
+import :pipeline_builder;
 import :progress_overlay;
+import :startup_timeline;
+import :quality_governor;
+import :thumbnailer;
+import :video_capture;
 
 namespace app
 {
@@ -96,6 +115,55 @@ namespace app
             void handle(result result);
 
             std::string get_controller_type() const;
+            // Batches the images and rectangles drawn through it, see render::draw_list.
+            render::draw_list make_draw_list(gui_renderer& renderer) {
+                return render::draw_list(renderer, *quad_render, get_shell_render_pass(), gui_colors.back(), &text_layouts, arena.get());
+            }
+            // Shared pipelines for blurring and for converting YUV420P video frames, waits for them if they are still being created.
+            std::shared_ptr<const render::blur_pass::pipeline_set> get_blur_pipelines() {
+                pipelines.wait("blur");
+                return blur_pipelines;
+            }
+            const render::yuv420p_pipeline& get_yuv420p_pipeline() {
+                pipelines.wait("yuv420p");
+                return *yuv420p;
+            }
+            thumbnailer& get_thumbnailer() {
+                return thumbnails;
+            }
+            // Thumbnails are packed into it, see render::icon_atlas.
+            render::icon_atlas& get_icon_atlas() {
+                return *icon_atlas;
+            }
+            // The edge length in pixels of an icon in the menu list (0.1 of the frame height), thumbnails are not needed any larger.
+            unsigned int get_thumbnail_size() const {
+                const auto size = static_cast<unsigned int>(std::ceil(win->swapchainExtent.height * 0.1));
+                return std::clamp(size, 1u, render::icon_atlas::max_icon_size);
+            }
+            // Startup times are measured from "start", which should be taken as early as possible in main().
+            void set_start_time(std::chrono::steady_clock::time_point start) {
+                startup.set_origin(start);
+            }
+            // In milliseconds since the start, negative while not reached yet.
+            double get_time_to_first_frame() const {
+                return startup.get(startup_timeline::stage::first_frame).value_or(startup_timeline::milliseconds(-1.0)).count();
+            }
+            double get_time_to_interactive() const {
+                return startup.get(startup_timeline::stage::interactive).value_or(startup_timeline::milliseconds(-1.0)).count();
+            }
+            // Memory for things that are only needed while the current frame is rendered.
+            frame_arena& get_frame_arena() {
+                return arena;
+            }
+            // Measures text through a cache, so text that is shown every frame is only measured once.
+            glm::vec2 measure_text(gui_renderer& renderer, std::string_view text, float size) {
+                return text_layouts.measure(renderer, text, size);
+            }
+            // Like measure_text, but also measures the lines of the text, see render::text_layout_cache::lay_out.
+            const render::text_layout_cache::layout& lay_out_text(gui_renderer& renderer, std::string_view text, float size) {
+                return text_layouts.lay_out(renderer, text, size);
+            }
+
             void render_controller_buttons(gui_renderer& renderer, float x, float y, std::ranges::range auto buttons) {
                 constexpr float min_width = 0.2f;
                 constexpr float size = 0.05f;
@@ -103,20 +171,24 @@ namespace app
                 float total_width = 0.0f;
                 float last_width = 0.0f;
                 for (const auto& [action, text] : buttons) {
-                    last_width = size_x/1.25f+renderer.measure_text(text, size).x;
+                    last_width = size_x/1.25f+measure_text(renderer, text, size).x;
                     total_width += std::max(min_width, last_width);
                 }
                 if(last_width < min_width) {
                     total_width -= (min_width - last_width);
                 }
 
+                auto list = make_draw_list(renderer);
                 float current_x = x - total_width/2;
                 for (const auto& [action, text] : buttons) {
                     auto icon = buttonTextures[std::to_underlying(action)].get();
-                    float width = std::max(min_width, size_x/1.25f+renderer.measure_text(text, size).x);
+                    float width = std::max(min_width, size_x/1.25f+measure_text(renderer, text, size).x);
                     if(action != action::none && icon) {
-                        renderer.draw_image(*icon, current_x, y, size/2.0, size/2.0);
-                        renderer.draw_text(text, current_x+size_x/1.25f, y+size*0.033f, size);
+                        if(!icon->loaded) {
+                            mark_dirty(dirty_tracker::reason::content);
+                        }
+                        list.draw_image(*icon, current_x, y, size/2.0, size/2.0);
+                        list.draw_text(text, current_x+size_x/1.25f, y+size*0.033f, size);
                     }
                     current_x += width;
                 }
@@ -124,21 +196,23 @@ namespace app
 
             dreamrender::window* get_window() const { return this->win; }
 
-            void set_ingame_mode(bool ingame_mode) { this->ingame_mode = ingame_mode; }
+            void set_ingame_mode(bool ingame_mode) {
+                this->ingame_mode = ingame_mode;
+                mark_dirty(dirty_tracker::reason::content);
+            }
             bool get_ingame_mode() const { return ingame_mode; }
 
             void set_background_only(bool background_only) {
                 this->background_only = background_only;
-                if(!this->background_only && !fixed_components_loaded) {
-                    preload_fixed_components();
-                }
+                mark_dirty(dirty_tracker::reason::content); // the menus are loaded by load_next_stage()
             }
             bool get_background_only() const { return background_only; }
 
             void set_blur_background(bool blur) {
                 if (blur == blur_background) return;
                 blur_background = blur;
-                last_blur_background_change = std::chrono::system_clock::now();
+                last_blur_background_change = utils::clock::now();
+                mark_dirty(dirty_tracker::reason::animation);
             }
             bool get_blur_background() const { return blur_background; }
 
@@ -148,10 +222,11 @@ namespace app
 
                 if(ptr->do_fade_in()) {
                     overlay_fade_direction = transition_direction::in;
-                    overlay_fade_time = std::chrono::system_clock::now();
+                    overlay_fade_time = utils::clock::now();
                 } else {
-                    overlay_fade_time = std::chrono::system_clock::now() - overlay_transition_duration;
+                    overlay_fade_time = utils::clock::now() - overlay_transition_duration;
                 }
+                mark_dirty(dirty_tracker::reason::content);
 
                 return ptr;
             }
@@ -163,10 +238,11 @@ namespace app
 
                 if(ptr->do_fade_in()) {
                     overlay_fade_direction = transition_direction::in;
-                    overlay_fade_time = std::chrono::system_clock::now();
+                    overlay_fade_time = utils::clock::now();
                 } else {
-                    overlay_fade_time = std::chrono::system_clock::now() - overlay_transition_duration;
+                    overlay_fade_time = utils::clock::now() - overlay_transition_duration;
                 }
+                mark_dirty(dirty_tracker::reason::content);
 
                 return ptr;
             }
@@ -174,12 +250,13 @@ namespace app
                 if(index >= overlays.size()) return;
                 if(index == overlays.size()-1 && overlays[index]->do_fade_out()) {
                     overlay_fade_direction = transition_direction::out;
-                    overlay_fade_time = std::chrono::system_clock::now();
+                    overlay_fade_time = utils::clock::now();
                     old_overlay = std::move(overlays[index]);
                 } else {
-                    overlay_fade_time = std::chrono::system_clock::now() - overlay_transition_duration;
+                    overlay_fade_time = utils::clock::now() - overlay_transition_duration;
                 }
                 overlays.erase(overlays.begin()+index);
+                mark_dirty(dirty_tracker::reason::content);
             }
 
             void set_clipboard(clipboard&& clipboard) {
@@ -187,23 +264,47 @@ namespace app
             }
             const std::optional<clipboard>& get_clipboard() const { return clipboard; }
 
+            // Thread-safe, wakes up the render loop if it is waiting for a change.
+            void mark_dirty(dirty_tracker::reason reason) {
+                if(dirty.mark(reason) && idle.load()) {
+                    wake_up();
+                }
+            }
+            // Something is going on that does not change the screen by itself yet (e.g. a menu loading in the background),
+            // so the current frame must not wait for a change.
+            void stay_awake() { awake = true; }
+
+            void start_benchmark(const benchmark::scenario& scenario, std::filesystem::path output, std::filesystem::path workloads) {
+                bench = std::make_unique<benchmark>(scenario, std::move(output), std::move(workloads));
+            }
+            bool has_benchmark_failed() const { return benchmark_failed; }
+            void run_input_script(input_script&& script) {
+                this->script = std::make_unique<input_script>(std::move(script));
+            }
+            // Encodes every rendered frame into "output", starting with the next prepare().
+            void start_capture(std::filesystem::path output, double fps) {
+                capture_output = std::move(output);
+                capture_fps = fps;
+            }
+
             auto get_local_time() const {
 #if __cpp_lib_chrono >= 201907L || defined(__GLIBCXX__)
                 static const std::chrono::time_zone* timezone = [](){
                     auto tz = std::chrono::current_zone();
-                    auto system = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+                    auto system = std::chrono::floor<std::chrono::seconds>(utils::clock::now());
                     auto local = std::chrono::zoned_time(tz, system);
                     spdlog::debug("{}", std::format("Timezone: {}, System Time: {}, Local Time: {}", tz->name(), system, local));
                     return tz;
                 }();
-                auto now = std::chrono::zoned_time(timezone, std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now()));
+                auto now = std::chrono::zoned_time(timezone, std::chrono::floor<std::chrono::seconds>(utils::clock::now()));
                 return now.get_local_time();
 #else
-                return std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+                return std::chrono::floor<std::chrono::seconds>(utils::clock::now());
 #endif
             }
         private:
             friend class blur_layer;
+            friend class benchmark;
 
             using time_point = std::chrono::time_point<std::chrono::system_clock>;
 
@@ -211,27 +312,86 @@ namespace app
             std::unique_ptr<image_renderer> image_render;
             std::unique_ptr<simple_renderer> simple_render;
             std::unique_ptr<render::wave_renderer> wave_render;
+            std::unique_ptr<render::quad_renderer> quad_render;
+            std::unique_ptr<render::icon_atlas> icon_atlas; // has to outlive the menus, which hold its icons
+            render::text_layout_cache text_layouts;
+            frame_arena arena;
+
+            std::shared_ptr<const render::blur_pass::pipeline_set> blur_pipelines;
+            std::unique_ptr<render::yuv420p_pipeline> yuv420p;
 
             vk::UniqueRenderPass backgroundRenderPass, shellRenderPass;
+            // like shellRenderPass, but leaves the frame ready to be scaled up by "upscale"
+            vk::UniqueRenderPass scaledShellRenderPass;
 
             std::vector<vk::UniqueFramebuffer> backgroundFramebuffers;
 
-            vk::UniqueDescriptorSetLayout blurDescriptorSetLayout;
-            vk::UniqueDescriptorPool blurDescriptorPool;
-            std::vector<vk::DescriptorSet> blurDescriptorSets;
-            vk::UniquePipelineLayout blurPipelineLayout;
-            vk::UniquePipeline blurPipeline;
-
-            std::unique_ptr<texture> renderImage;
-            std::unique_ptr<texture> blurImageSrc;
-            std::unique_ptr<texture> blurImageDst;
+            // Slots 0..n-1 (one per swapchain image) hold the backdrop, slots n..2n-1 are used by blur_layer.
+            std::unique_ptr<render::blur_pass> backdrop_blur;
+            std::unique_ptr<render::gpu_timer> gpu_timer;
+            std::unique_ptr<video_capture> capture;
+            std::filesystem::path capture_output;
+            double capture_fps = 0.0;
+
+            std::vector<std::unique_ptr<texture>> renderImages;
+
+            // Everything the blurred backdrop in backdrop_blur depends on, so it can be reused while nothing changed.
+            struct backdrop_key {
+                config::config::background_type type;
+                glm::vec3 color;
+                glm::vec3 wave_color;
+                const texture* image;
+                bool image_loaded;
+                bool ingame;
+
+                bool operator==(const backdrop_key&) const = default;
+            };
+            const time_point start_time = utils::clock::now();
+
+            std::optional<backdrop_key> cached_backdrop;
+            unsigned int backdrop_slot = 0;
+            unsigned int backdrop_age = 0; // frames since the backdrop was last blurred
+
+            quality_governor governor;
+            void update_quality(std::chrono::duration<double> cpu_time);
+
+            // Only exists if the shell may render at a lower resolution (see config::minRenderScale).
+            std::unique_ptr<render::upscale_pass> upscale;
+            // declared after everything its jobs write to, so it waits for them before those are destroyed
+            pipeline_builder pipelines;
+            resolution_governor resolution;
+            float render_scale = 1.0f;
+            float pending_render_scale = 1.0f; // applied at the start of the next frame
+            vk::Extent2D renderExtent;
+            void create_render_targets();
+
+            bool is_scaled() const {
+                return upscale && render_scale < 1.0f;
+            }
+            vk::RenderPass get_shell_render_pass() const {
+                return is_scaled() ? scaledShellRenderPass.get() : shellRenderPass.get();
+            }
+            // The image the shell renders into and the layout the shell render pass leaves it in.
+            vk::Image get_render_image(int frame) const {
+                return is_scaled() ? upscale->get_image(frame) : swapchainImages[frame];
+            }
+            vk::ImageLayout get_render_layout() const {
+                return is_scaled() ? vk::ImageLayout::eShaderReadOnlyOptimal : win->swapchainFinalLayout;
+            }
 
             std::vector<vk::Image> swapchainImages;
+            std::vector<vk::ImageView> swapchainViews;
             std::vector<vk::UniqueFramebuffer> framebuffers;
 
             std::unique_ptr<texture> backgroundTexture;
+            thumbnailer thumbnails;
             main_menu menu{this};
             news_display news{this};
+            frame_profiler profiler;
+            perf_hud perf{profiler};
+            std::unique_ptr<benchmark> bench;
+            bool benchmark_failed = false;
+            std::unique_ptr<input_script> script;
             std::array<std::unique_ptr<texture>, std::to_underlying(action::_length)> buttonTextures;
 
             sdl::mix::unique_chunk ok_sound;
@@ -242,11 +402,78 @@ namespace app
             void tick_cursor();
             bool handle_cursor(const event& event);
 
+            // Startup is split into stages (see startup_timeline), only the background is loaded before the first frame.
+            startup_timeline startup;
+            bool stream_startup = true;
+            bool gui_renderers_ready = false;
             bool fixed_components_loaded = false;
+            bool prepare_gui_renderers(bool wait);
+            void preload_icons();
             void preload_fixed_components();
+            void load_next_stage();
 
             void render_gui(gui_renderer& renderer);
 
+            // The colors pushed onto the gui_renderer by render_gui, so draw lists can apply them as well.
+            std::vector<glm::vec4> gui_colors{glm::vec4(1.0f)};
+            void push_gui_color(gui_renderer& renderer, glm::vec4 color) {
+                renderer.push_color(color);
+                gui_colors.push_back(gui_colors.back() * color);
+            }
+            void pop_gui_color(gui_renderer& renderer) {
+                renderer.pop_color();
+                gui_colors.pop_back();
+            }
+
+            // The date and time shown next to the menu, only formatted again when the second or the format changes.
+            std::string clock_text;
+            std::string clock_format;
+            std::string clock_pattern;
+            std::chrono::seconds clock_time{-1};
+            std::string_view get_clock_text(auto local_now) {
+                if(local_now.time_since_epoch() == clock_time && clock_format == config::CONFIG.dateTimeFormat) {
+                    return clock_text;
+                }
+                if(clock_format != config::CONFIG.dateTimeFormat) {
+                    clock_format = config::CONFIG.dateTimeFormat;
+                    clock_pattern = "{:"+clock_format+"}";
+                }
+                clock_time = local_now.time_since_epoch();
+                clock_text.clear();
+                std::vformat_to(std::back_inserter(clock_text), clock_pattern, std::make_format_args(local_now));
+                return clock_text;
+            }
+
+#if __cpp_lib_chrono >= 201907L || defined(__GLIBCXX__)
+            using local_time = std::chrono::local_seconds;
+#else
+            using local_time = std::chrono::sys_seconds;
+#endif
+            vk::ClearValue get_background_clear_color(const local_time& local_now) const;
+            void render_background(vk::CommandBuffer commandBuffer, int frame, vk::RenderPass renderPass, const local_time& local_now);
+
+            // The background rendered at a lower resolution and/or rate (see render::background_layer), if enabled.
+            std::unique_ptr<render::background_layer> background_layer;
+            std::unique_ptr<render::background_layer> retired_background_layer; // until no frame in flight shows it anymore
+            unsigned int retired_background_layer_frames = 0;
+            time_point last_background_update;
+            // Renders the background layer if it is due, returns whether the frame should show it instead of rendering the background itself.
+            bool update_background_layer(vk::CommandBuffer commandBuffer, int frame, const local_time& local_now);
+            void retire_background_layer();
+            std::optional<backdrop_key> get_backdrop_key(const local_time& local_now) const;
+
+            dirty_tracker dirty;
+            // Whether each swapchain image still shows an older state than the current one.
+            std::vector<bool> stale_images;
+            std::chrono::sys_seconds last_rendered_second{};
+            bool needs_redraw(int frame);
+            // Blocks until there is an input event, a change is reported or the clock shows the next second.
+            void wait_for_change();
+            void wake_up();
+            std::atomic<bool> idle = false;
+            bool awake = false;
+            std::uint32_t wake_event = 0;
+
             // input handling
             constexpr static int controller_axis_input_threshold = constants::controller_axis_input_threshold;
             std::array<glm::vec2, 2> controller_axis_position;
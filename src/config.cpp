@@ -18,6 +18,7 @@ module;
 
 #include <glm/vec3.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
 #include <filesystem>
@@ -33,6 +34,7 @@ import glibmm;
 import giomm;
 import vulkan_hpp;
 import xmbshell.constants;
+import xmbshell.trace;
 
 namespace config {
 
@@ -84,12 +86,17 @@ std::optional<config::color_scheme> parse_color_scheme(std::string_view hex) {
 }
 
 void config::on_update(const Glib::ustring& key) {
+    trace::scope span("config update", key.raw());
     reload();
     spdlog::trace("Config key changed: {}", key.c_str());
     auto cbs = callbacks.equal_range(key);
     for(auto it = cbs.first; it != cbs.second; ++it) {
         it->second(key);
     }
+    auto all = callbacks.equal_range("*");
+    for(auto it = all.first; it != all.second; ++it) {
+        it->second(key);
+    }
 }
 
 void config::load() {
@@ -143,6 +150,30 @@ void config::reload() {
 
     showFPS = renderSettings->get_boolean("show-fps");
     showMemory = renderSettings->get_boolean("show-mem");
+    showPerformance = renderSettings->get_boolean("show-perf");
+    onDemandRendering = renderSettings->get_boolean("on-demand-rendering");
+    adaptiveQuality = renderSettings->get_boolean("adaptive-quality");
+    backgroundScale = std::clamp(renderSettings->get_double("background-scale"), 0.25, 1.0);
+    backgroundRate = std::max(0, renderSettings->get_int("background-rate"));
+    minRenderScale = std::clamp(renderSettings->get_double("min-render-scale"), 0.5, 1.0);
+    renderSharpness = std::clamp(renderSettings->get_double("render-sharpness"), 0.0, 1.0);
+
+    applyOverrides();
+}
+
+void config::setOverrides(override_values values) {
+    overrides = values;
+    applyOverrides();
+}
+
+void config::applyOverrides() {
+    if(overrides.onDemandRendering) {
+        onDemandRendering = *overrides.onDemandRendering;
+    }
+    if(overrides.maxFPS) {
+        setMaxFPS(*overrides.maxFPS);
+    }
+    fixedRenderScale = overrides.renderScale;
 }
 
 void config::addCallback(const std::string& key, std::function<void(const std::string&)> callback) {
@@ -22,6 +22,7 @@ module;
 #include <filesystem>
 #include <map>
 #include <functional>
+#include <optional>
 #include <unordered_set>
 #include <variant>
 #include <version>
@@ -178,6 +179,15 @@ export namespace config
 
             bool showFPS    = false;
             bool showMemory = false;
+            bool showPerformance = false;
+
+            bool onDemandRendering = true;
+            bool adaptiveQuality = true;
+            double backgroundScale = 1.0;
+            int backgroundRate = 0; // per second, 0 means every frame
+            double minRenderScale = 1.0;
+            double renderSharpness = 0.5;
+            std::optional<double> fixedRenderScale; // only set by --render-scale, replaces the adaptive render scale
 
             std::filesystem::path   fontPath;
             background_type			backgroundType = background_type::wave;
@@ -197,6 +207,7 @@ export namespace config
 
             void load();
             void reload();
+            // Callbacks registered for the key "*" are called for every changed key.
             void addCallback(const std::string& key, std::function<void(const std::string&)> callback);
 
             void setSampleCount(vk::SampleCountFlagBits count);
@@ -215,7 +226,18 @@ export namespace config
             void setLanguage(const std::string& lang);
 
             void excludeApplication(const std::string& application, bool exclude = true);
+
+            // Values forced by command line options (e.g. for benchmarks), they win over the settings even after a reload.
+            struct override_values {
+                std::optional<bool> onDemandRendering;
+                std::optional<double> maxFPS;
+                std::optional<double> renderScale;
+            };
+            void setOverrides(override_values values);
         private:
+            override_values overrides;
+            void applyOverrides();
+
             Glib::RefPtr<Gio::Settings> shellSettings, renderSettings;
             std::multimap<std::string, std::function<void(const std::string&)>> callbacks;
             void on_update(const Glib::ustring& key);
@@ -27,6 +27,7 @@ import spdlog;
 import sdl2;
 import xmbshell.app;
 import xmbshell.config;
+import xmbshell.trace;
 
 namespace dbus
 {
@@ -40,6 +41,7 @@ namespace dbus
         object = sdbus::createObject(*connection, objectPath);
 
         auto close = [this](){
+            trace::scope span("D-Bus close");
             spdlog::info("Exit request from D-Bus");
             sdl::Event event = {
                 .quit = {
@@ -50,22 +52,42 @@ namespace dbus
             sdl::PushEvent(&event);
         };
         auto ingame = [this](){
+            trace::scope span("D-Bus ingame");
             spdlog::info("Ingame XMB request from D-Bus");
             sdl::RaiseWindow(win->win.get());
             xmb->set_ingame_mode(true);
         };
+        // an empty path writes the trace into a new file in the temporary directory, returns the path that was written
+        auto dump_trace = [](const std::string& path) -> std::string {
+            spdlog::info("Trace dump request from D-Bus");
+            try {
+                if(path.empty()) {
+                    return trace::dump().string();
+                }
+                trace::dump(path);
+                return path;
+            } catch(const std::exception& e) {
+                throw sdbus::Error("re.jcm.xmbos.Error.Trace", e.what());
+            }
+        };
 
         object->registerMethod("close").onInterface("re.jcm.xmbos.Window").implementedAs(std::move(close));
         object->registerMethod("ingame").onInterface("re.jcm.xmbos.Window").implementedAs(std::move(ingame));
+        object->registerMethod("dumpTrace").onInterface("re.jcm.xmbos.Debug").implementedAs(std::move(dump_trace));
         object->registerProperty("fps").onInterface("re.jcm.xmbos.Render").withGetter([this](){return win->currentFPS;});
         object->registerProperty("re.jcm.xmbos.Render", "maxFps", "i",
             [this](sdbus::PropertyGetReply& reply){reply << static_cast<int>(config::CONFIG.maxFPS);},
             [this](sdbus::PropertySetCall& call){
+                trace::scope span("D-Bus set maxFps");
                 int maxFPS{};
                 call >> maxFPS;
                 config::CONFIG.setMaxFPS(maxFPS);
             });
 
+        // in milliseconds since the process started, negative while the shell has not gotten there yet
+        object->registerProperty("timeToFirstFrame").onInterface("re.jcm.xmbos.Startup").withGetter([this](){return xmb->get_time_to_first_frame();});
+        object->registerProperty("timeToInteractive").onInterface("re.jcm.xmbos.Startup").withGetter([this](){return xmb->get_time_to_interactive();});
+
         object->finishRegistration();
 #endif
     }
@@ -74,13 +96,20 @@ namespace dbus
     {
 #if __linux__
         connection->leaveEventLoop();
+        if(loop_thread.joinable()) {
+            loop_thread.join();
+        }
 #endif
     }
 
     void dbus_server::run()
     {
 #if __linux__
-        connection->enterEventLoopAsync();
+        // our own thread instead of enterEventLoopAsync(), so it has a name in the trace
+        loop_thread = std::thread([this](){
+            trace::set_thread_name("dbus");
+            connection->enterEventLoop();
+        });
 #endif
     }
 }
@@ -16,6 +16,8 @@
  */
 module;
 
+#include <thread>
+
 #if __linux__
 #include <sdbus-c++/sdbus-c++.h>
 #endif
@@ -36,6 +38,7 @@ export namespace dbus
 #if __linux__
             std::unique_ptr<sdbus::IConnection> connection;
             std::unique_ptr<sdbus::IObject> object;
+            std::thread loop_thread;
 #endif
             dreamrender::window* win;
             app::xmbshell* xmb;
@@ -15,13 +15,22 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
+#include <optional>
 #include <thread>
 
 #include <libintl.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 
+#if __linux__
+#include <csignal>
+#include <glib-unix.h>
+#endif
+
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
 
@@ -35,6 +44,8 @@ import avcpp;
 import xmbshell.app;
 import xmbshell.dbus;
 import xmbshell.config;
+import xmbshell.trace;
+import xmbshell.utils;
 
 #if __linux__
 std::string find_visualid() {
@@ -57,6 +68,9 @@ std::string find_visualid() {
 #undef main
 int main(int argc, char *argv[])
 {
+    // the startup times are measured from here
+    const auto process_start = std::chrono::steady_clock::now();
+    trace::set_thread_name("render");
 #ifndef NDEBUG
     spdlog::set_level(spdlog::level::debug);
 #endif
@@ -87,8 +101,33 @@ int main(int argc, char *argv[])
         .help("Output pattern for headless mode")
         .metavar("PATTERN")
         .default_value("frame_{:06d}.png");
+    program.add_argument("--headless-encode")
+        .help("Run in headless mode and encode all frames into a single video file (e.g. out.webm) instead of writing images")
+        .metavar("FILE");
     program.add_argument("--terminal").flag()
         .help("Run in terminal mode (requires --width and --height)");
+    program.add_argument("--fixed-fps")
+        .help("Advance all animations by 1/FPS per rendered frame instead of following the system clock (useful with --headless)")
+        .metavar("FPS")
+        .scan<'g', double>();
+    program.add_argument("--render-scale")
+        .help("Always render at this fraction of the screen resolution and scale the frames up (e.g. to test upscaling)")
+        .metavar("SCALE")
+        .scan<'g', double>();
+    program.add_argument("--input-script")
+        .help("Run the input events of a script keyed to frame numbers (see src/app/input_script.cppm for the format)")
+        .metavar("FILE");
+    program.add_argument("--benchmark")
+        .help("Run a benchmark scenario headless and without frame output, then quit (use \"list\" to show all scenarios)")
+        .metavar("SCENARIO");
+    program.add_argument("--benchmark-output")
+        .help("File to write the benchmark results to as JSON")
+        .metavar("FILE")
+        .default_value("benchmark.json");
+    program.add_argument("--benchmark-workloads")
+        .help("Directory with the files created by benchmarks/generate-workloads.sh")
+        .metavar("DIRECTORY")
+        .default_value("build/benchmark-workloads");
 
     try {
         program.parse_args(argc, argv);
@@ -125,9 +164,21 @@ int main(int argc, char *argv[])
 #else
     std::thread main_loop_thread([&loop]() {
 #endif
+        trace::set_thread_name("glib");
         loop = Glib::MainLoop::create();
         loop->run();
     });
+#if __linux__
+    // "kill -USR1" writes the most recent trace events into a file in the temporary directory
+    g_unix_signal_add(SIGUSR1, [](gpointer) -> gboolean {
+        try {
+            trace::dump();
+        } catch(const std::exception& e) {
+            spdlog::error("Failed to write the trace: {}", e.what());
+        }
+        return G_SOURCE_CONTINUE;
+    }, nullptr);
+#endif
 
     // Initialize avcpp
     av::init();
@@ -146,6 +197,65 @@ int main(int argc, char *argv[])
     config::CONFIG.load();
     spdlog::debug("Config loaded");
 
+    config::config::override_values overrides;
+    const app::benchmark::scenario* benchmark_scenario = nullptr;
+    if(auto name = program.present("--benchmark")) {
+        if(*name == "list") {
+            for(const auto& s : app::benchmark::get_scenarios()) {
+                std::cout << s.name << ": " << s.description << std::endl;
+            }
+            std::exit(0);
+        }
+        benchmark_scenario = app::benchmark::find_scenario(*name);
+        if(!benchmark_scenario) {
+            spdlog::error("Unknown benchmark scenario \"{}\", use \"--benchmark list\" to show all scenarios", *name);
+            std::exit(1);
+        }
+        auto workload = std::filesystem::path(program.get<std::string>("--benchmark-workloads")) / benchmark_scenario->workload;
+        if(!benchmark_scenario->workload.empty() && !std::filesystem::exists(workload)) {
+            spdlog::error("Benchmark workload {} does not exist, create it with benchmarks/generate-workloads.sh", workload.string());
+            std::exit(1);
+        }
+        // render every frame as fast as possible, so the frame times mean something
+        overrides.onDemandRendering = false;
+        overrides.maxFPS = 0;
+    }
+    auto encode_output = program.present("--headless-encode");
+    if(encode_output) {
+        // every frame becomes a frame of the video, even if nothing changed
+        overrides.onDemandRendering = false;
+    }
+    // animations of a benchmark or a video should not depend on how fast it runs
+    const double default_fps = encode_output ? 30.0 : 60.0;
+    const auto fixed_fps = program.present<double>("--fixed-fps");
+    if(fixed_fps && (!std::isfinite(*fixed_fps) || *fixed_fps <= 0.0)) {
+        spdlog::error("The fixed frame rate has to be greater than 0");
+        std::exit(1);
+    }
+    if(fixed_fps || benchmark_scenario || encode_output) {
+        utils::clock::use_fixed_step(std::chrono::duration<double>(1.0 / fixed_fps.value_or(default_fps)));
+        // time no longer depends on the wall clock, so there is no reason to wait between frames
+        overrides.maxFPS = 0;
+    }
+    if(auto scale = program.present<double>("--render-scale")) {
+        if(*scale <= 0.0 || *scale > 1.0) {
+            spdlog::error("The render scale has to be greater than 0 and at most 1");
+            std::exit(1);
+        }
+        overrides.renderScale = *scale;
+    }
+    // kept apart from the settings, so changing a setting while the shell runs does not undo them
+    config::CONFIG.setOverrides(overrides);
+    std::optional<app::input_script> input_script;
+    if(auto path = program.present("--input-script")) {
+        try {
+            input_script = app::input_script::load(*path);
+        } catch(const std::exception& e) {
+            spdlog::error("{}", e.what());
+            std::exit(1);
+        }
+    }
+
     SDL_SetMainReady();
 
     dreamrender::window_config window_config;
@@ -162,14 +272,18 @@ int main(int argc, char *argv[])
     window_config.width = program.get<int>("--width");
     window_config.height = program.get<int>("--height");
     window_config.fullscreen = !program.get<bool>("--no-fullscreen");
-    window_config.headless = program.get<bool>("--headless") || program.get<bool>("--terminal");
+    window_config.headless = program.get<bool>("--headless") || program.get<bool>("--terminal") || benchmark_scenario || encode_output;
     window_config.headless_terminal = program.get<bool>("--terminal");
+    if(benchmark_scenario && (window_config.width == -1 || window_config.height == -1)) {
+        window_config.width = 1280;
+        window_config.height = 720;
+    }
     if(window_config.headless && (window_config.width == -1 || window_config.height == -1)) {
         spdlog::error("Headless mode requires --width and --height");
         std::exit(1);
     }
     // This purposefully excludes the case, in which just "--terminal" is used
-    if(program.is_used("--headless") || program.is_used("--headless-output-dir") || program.is_used("--headless-output-pattern")) {
+    if(!benchmark_scenario && !encode_output && (program.is_used("--headless") || program.is_used("--headless-output-dir") || program.is_used("--headless-output-pattern"))) {
         window_config.headless_output_dir = program.get<std::string>("--headless-output-dir");
         window_config.headless_output_format = program.get<std::string>("--headless-output-pattern");
     } else {
@@ -180,9 +294,20 @@ int main(int argc, char *argv[])
     window.init();
 
     auto* shell = new app::xmbshell(&window);
+    shell->set_start_time(process_start);
     if(program.get<bool>("--background-only")) {
         shell->set_background_only(true);
     }
+    if(input_script) {
+        shell->run_input_script(std::move(*input_script));
+    }
+    if(encode_output) {
+        shell->start_capture(*encode_output, fixed_fps.value_or(default_fps));
+    }
+    if(benchmark_scenario) {
+        shell->start_benchmark(*benchmark_scenario, program.get<std::string>("--benchmark-output"),
+            program.get<std::string>("--benchmark-workloads"));
+    }
     window.set_phase(shell, shell, shell, shell); // window takes ownership of shell
 
     std::unique_ptr<dbus::dbus_server> server;
@@ -203,5 +328,5 @@ int main(int argc, char *argv[])
     main_loop_thread.join();
 #endif
 
-    return 0;
+    return shell->has_benchmark_failed() ? 1 : 0;
 }
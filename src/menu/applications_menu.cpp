@@ -17,9 +17,12 @@
 module;
 
 #include <algorithm>
+#include <cstddef>
 #include <filesystem>
 #include <functional>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 module xmbshell.app;
@@ -32,6 +35,7 @@ import dreamrender;
 import xmbshell.config;
 
 import :applications_menu;
+import :menu_utils;
 import :choice_overlay;
 import :message_overlay;
 
@@ -40,31 +44,56 @@ namespace menu {
 using namespace mfk::i18n::literals;
 
 applications_menu::applications_menu(std::string name, dreamrender::texture&& icon, app::xmbshell* xmb, dreamrender::resource_loader& loader, AppFilter filter)
-    : simple_menu(std::move(name), std::move(icon)), xmb(xmb), loader(loader), filter(filter)
+    : async_menu(std::move(name), std::move(icon),
+        make_simple<simple_menu_entry>("Loading..."_(), config::CONFIG.asset_directory/"icons/icon_category_application.png", loader)),
+      xmb(xmb), loader(loader), filter(filter)
 {
-    auto appInfos = Gio::AppInfo::get_all();
-    for (const auto& app : appInfos) {
-        if(!filter(app.get()))
-            continue;
-        bool is_hidden = config::CONFIG.excludedApplications.contains(app->get_id());
-        if(!show_hidden && is_hidden)
-            continue;
+    // Gio::AppInfo::get_all() reads every .desktop file on the system.
+    // The settings can be reloaded while the provider runs, so it gets its own copy of the excluded applications.
+    populate([this, excluded = config::CONFIG.excludedApplications, show_hidden = show_hidden]{
+        entry_list entries;
+        auto appInfos = Gio::AppInfo::get_all();
+        for (const auto& app : appInfos) {
+            if(!this->filter(app.get()))
+                continue;
+            bool is_hidden = excluded.contains(app->get_id());
+            if(!show_hidden && is_hidden)
+                continue;
 
-        spdlog::trace("Found application: {} ({})", app->get_display_name(), app->get_id());
-        auto entry = create_action_menu_entry(app, is_hidden);
-        apps.push_back(app);
-        entries.push_back(std::move(entry));
+            spdlog::trace("Found application: {} ({})", app->get_display_name(), app->get_id());
+            auto entry = create_action_menu_entry(app, is_hidden);
+            loaded_apps.push_back(app);
+            loaded_icons.push_back(find_icon(app));
+            entries.push_back(std::move(entry));
+        }
+        return entries;
+    });
+}
+
+bool applications_menu::poll() {
+    if(!async_menu::poll()) {
+        return false;
     }
+    apps = std::move(loaded_apps);
+    // the entries are gone if the provider failed
+    for(std::size_t i = 0; i < entries.size() && i < loaded_icons.size(); i++) {
+        if(!loaded_icons[i].empty()) {
+            loader.loadTexture(&static_cast<action_menu_entry&>(*entries[i]).get_icon(), loaded_icons[i]);
+        }
+    }
+    loaded_icons.clear();
+    return true;
 }
 
-std::unique_ptr<action_menu_entry> applications_menu::create_action_menu_entry(Glib::RefPtr<Gio::AppInfo> app, bool hidden) {
-    std::string icon_path;
+std::string applications_menu::find_icon(const Glib::RefPtr<Gio::AppInfo>& app) {
     if(auto r = utils::resolve_icon(app->get_icon().get())) {
-        icon_path = r->string();
-    } else {
-        spdlog::warn("Could not resolve icon for application: {}", app->get_display_name());
+        return r->string();
     }
+    spdlog::warn("Could not resolve icon for application: {}", app->get_display_name());
+    return {};
+}
 
+std::unique_ptr<action_menu_entry> applications_menu::create_action_menu_entry(Glib::RefPtr<Gio::AppInfo> app, bool hidden) {
     dreamrender::texture icon_texture(loader.getDevice(), loader.getAllocator());
     std::string name = app->get_display_name();
     if(hidden) {
@@ -72,13 +101,11 @@ std::unique_ptr<action_menu_entry> applications_menu::create_action_menu_entry(G
     }
     auto entry = std::make_unique<action_menu_entry>(name, std::move(icon_texture),
         std::function<result()>{}, [this, app](auto && PH1) { return activate_app(app, std::forward<decltype(PH1)>(PH1)); });
-    if(!icon_path.empty()) {
-        loader.loadTexture(&entry->get_icon(), icon_path);
-    }
     return entry;
 }
 
 void applications_menu::reload() {
+    const unsigned int old_count = entries.size();
     auto appInfos = Gio::AppInfo::get_all();
     for (const auto& app : appInfos) {
         bool is_hidden = config::CONFIG.excludedApplications.contains(app->get_id());
@@ -91,6 +118,9 @@ void applications_menu::reload() {
             if(should_include) {
                 spdlog::trace("Found new application: {} ({})", app->get_display_name(), app->get_id());
                 auto entry = create_action_menu_entry(app, is_hidden);
+                if(auto icon = find_icon(app); !icon.empty()) {
+                    loader.loadTexture(&entry->get_icon(), icon);
+                }
                 apps.push_back(app);
                 entries.push_back(std::move(entry));
             }
@@ -103,6 +133,9 @@ void applications_menu::reload() {
             }
         }
     }
+    if(entries.size() != old_count) {
+        notify_entries_changed(old_count, entries.size());
+    }
 }
 
 result applications_menu::activate_app(Glib::RefPtr<Gio::AppInfo> app, action action) {
@@ -157,19 +190,22 @@ result applications_menu::activate_app(Glib::RefPtr<Gio::AppInfo> app, action ac
 }
 
 result applications_menu::activate(action action) {
+    if(is_loading()) {
+        return result::unsupported;
+    }
     if(action == action::extra) {
         show_hidden = !show_hidden;
         reload();
         return result::success;
     }
-    return simple_menu::activate(action);
+    return async_menu::activate(action);
 }
 
-void applications_menu::get_button_actions(std::vector<std::pair<action, std::string>>& v) {
+void applications_menu::get_button_actions(std::pmr::vector<std::pair<action, std::pmr::string>>& v) {
     v.emplace_back(action::none, "");
     v.emplace_back(action::none, "");
-    v.emplace_back(action::options, "Options"_());
-    v.emplace_back(action::extra, show_hidden ? "Hide excluded apps"_() : "Show excluded apps"_());
+    v.emplace_back(action::options, std::string_view{"Options"_});
+    v.emplace_back(action::extra, show_hidden ? std::string_view{"Hide excluded apps"_} : std::string_view{"Show excluded apps"_});
 }
 
 }
@@ -18,6 +18,8 @@ module;
 
 #include <functional>
 #include <memory>
+#include <memory_resource>
+#include <vector>
 #include <sstream>
 #include <string>
 #include <unordered_set>
@@ -71,16 +73,22 @@ export namespace menu {
         };
     }
 
-    class applications_menu : public simple_menu {
+    class applications_menu : public async_menu {
         public:
             applications_menu(std::string name, dreamrender::texture&& icon, app::xmbshell* xmb, dreamrender::resource_loader& loader, AppFilter filter = noFilter());
-            ~applications_menu() override = default;
+            ~applications_menu() override {
+                wait();
+            }
 
+            bool poll() override;
             result activate(action action) override;
-            void get_button_actions(std::vector<std::pair<action, std::string>>& v) override;
+            void get_button_actions(std::pmr::vector<std::pair<action, std::pmr::string>>& v) override;
         private:
             void reload();
+            // The entry starts without its icon, the loader has to be called on the main thread.
             std::unique_ptr<action_menu_entry> create_action_menu_entry(Glib::RefPtr<Gio::AppInfo> app, bool hidden = false);
+            // Path of the icon of "app", empty if there is none.
+            static std::string find_icon(const Glib::RefPtr<Gio::AppInfo>& app);
             result activate_app(Glib::RefPtr<Gio::AppInfo> app, action action);
 
             app::xmbshell* xmb;
@@ -89,6 +97,8 @@ export namespace menu {
             bool show_hidden = false;
             AppFilter filter;
             std::vector<Glib::RefPtr<Gio::AppInfo>> apps;
+            std::vector<Glib::RefPtr<Gio::AppInfo>> loaded_apps; // written by the provider, moved to "apps" in poll()
+            std::vector<std::string> loaded_icons; // written by the provider, one per entry, loaded in poll()
     };
 
 }
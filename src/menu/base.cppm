@@ -19,10 +19,16 @@ module;
 #include <string>
 #include <stdexcept>
 #include <functional>
+#include <future>
 #include <memory>
+#include <memory_resource>
+#include <vector>
 
 export module xmbshell.app:menu_base;
 import dreamrender;
+import spdlog;
+import xmbshell.render;
+import xmbshell.trace;
 import xmbshell.utils;
 
 export namespace menu {
@@ -34,6 +40,10 @@ class menu_entry {
         virtual std::string_view get_name() const = 0;
         virtual std::string_view get_description() const = 0;
         virtual const dreamrender::texture& get_icon() const = 0;
+        // An icon packed into the icon atlas, which is drawn instead of get_icon() if there is one.
+        virtual const render::icon_atlas::icon* get_atlas_icon() const {
+            return nullptr;
+        }
         virtual result activate(action action) {
             return result::unsupported;
         }
@@ -56,9 +66,30 @@ class menu : public menu_entry {
         }
         virtual void on_close() {
         }
-        virtual void get_button_actions(std::vector<std::pair<action, std::string>>& v) {
+        virtual void get_button_actions(std::pmr::vector<std::pair<action, std::pmr::string>>& v) {
+
+        }
+        // Called on the main thread before every frame, returns whether the submenus changed (see async_menu_generic).
+        virtual bool poll() {
+            return false;
+        }
+        // Whether poll() is still waiting for work on another thread.
+        virtual bool is_loading() const {
+            return false;
+        }
 
+        // "callback" is called with the old and the new number of submenus whenever submenus were added or removed.
+        void on_entries_changed(std::function<void(unsigned int, unsigned int)> callback) {
+            entries_changed = std::move(callback);
         }
+    protected:
+        void notify_entries_changed(unsigned int old_count, unsigned int new_count) {
+            if(entries_changed) {
+                entries_changed(old_count, new_count);
+            }
+        }
+    private:
+        std::function<void(unsigned int, unsigned int)> entries_changed;
 };
 
 template<typename T>
@@ -68,7 +99,9 @@ class simple : public T {
 
         simple(std::string name, icon_type&& icon, std::string description = "") :
             name(std::move(name)), icon(std::move(icon)), description(std::move(description)) {}
-        ~simple() override = default;
+        ~simple() override {
+            render::quad_renderer::forget(icon.imageView.get());
+        }
 
         std::string_view get_name() const override {
             return name;
@@ -95,7 +128,12 @@ class simple_shared : public T {
 
         simple_shared(std::string name, icon_type&& icon, std::string description = "") :
             name(std::move(name)), icon(std::move(icon)), description(std::move(description)) {}
-        ~simple_shared() override = default;
+        ~simple_shared() override {
+            // forgetting a texture that is still alive elsewhere only costs a new descriptor set
+            if(icon) {
+                render::quad_renderer::forget(icon->imageView.get());
+            }
+        }
 
         std::string_view get_name() const override {
             return name;
@@ -204,4 +242,69 @@ class simple_menu_generic : public Base {
 using simple_menu = simple_menu_generic<simple_menu_shallow>;
 using simple_menu_shared = simple_menu_generic<simple_menu_shallow_shared>;
 
+/* A menu whose entries are created by a provider on a background thread, so slow providers (D-Bus, scanning installed
+ * applications) do not delay the startup. Until the provider is done, the menu only contains a placeholder entry.
+ * The entries are taken over on the main thread in poll(), which notifies the listener of on_entries_changed().
+ *
+ * The provider must not touch the menu's entries and should only read members that do not change while it runs.
+ * Subclasses whose provider uses their own members have to call wait() in their destructor.
+ */
+template<typename Base>
+class async_menu_generic : public simple_menu_generic<Base> {
+    public:
+        using entry_list = std::vector<std::unique_ptr<menu_entry>>;
+        using provider = std::function<entry_list()>;
+
+        async_menu_generic(std::string name, Base::icon_type&& icon, std::unique_ptr<menu_entry> placeholder, std::string description = "") :
+            simple_menu_generic<Base>(std::move(name), std::move(icon), std::move(description))
+        {
+            this->entries.push_back(std::move(placeholder));
+        }
+        ~async_menu_generic() override {
+            wait();
+        }
+
+        bool is_loading() const override {
+            return pending.valid();
+        }
+
+        bool poll() override {
+            if(!pending.valid() || !utils::is_ready(pending)) {
+                return false;
+            }
+            const unsigned int old_count = this->entries.size();
+            try {
+                this->entries = pending.get();
+            } catch(const std::exception& e) {
+                spdlog::error("Failed to load the entries of menu \"{}\": {}", this->get_name(), e.what());
+                this->entries.clear();
+            }
+            this->selected_submenu = 0;
+            this->notify_entries_changed(old_count, this->entries.size());
+            return true;
+        }
+        result activate(action action) override {
+            if(is_loading()) {
+                return result::unsupported;
+            }
+            return simple_menu_generic<Base>::activate(action);
+        }
+    protected:
+        // Runs "p" on a background thread, its entries replace the current ones once it is done.
+        void populate(provider p) {
+            pending = std::async(std::launch::async, [p = std::move(p), name = std::string(this->get_name())] {
+                trace::scope span("load menu", name);
+                return p();
+            });
+        }
+        void wait() {
+            if(pending.valid()) {
+                pending.wait();
+            }
+        }
+    private:
+        std::future<entry_list> pending;
+};
+using async_menu = async_menu_generic<simple_menu_shallow>;
+
 }
@@ -20,7 +20,9 @@ module;
 #include <filesystem>
 #include <functional>
 #include <numeric>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <unordered_set>
 #include <variant>
 #include <vector>
@@ -37,6 +39,7 @@ import :choice_overlay;
 import :programs;
 
 import xmbshell.config;
+import xmbshell.render;
 import xmbshell.utils;
 import dreamrender;
 import glibmm;
@@ -73,6 +76,7 @@ namespace menu {
                     "standard::icon"                ","
                     "standard::is-hidden"           ","
                     "standard::is-backup"           ","
+                    "time::modified"                ","
                     "thumbnail::path"               ","
                     "thumbnail::is-valid");
                 if(!info) {
@@ -105,11 +109,8 @@ namespace menu {
 
                 std::filesystem::path icon_file_path = config::CONFIG.asset_directory/
                     "icons"/("icon_files_type_"+content_type_key+".png");
-                if(thumbnail_is_valid && !thumbnail_path.empty()) {
-                    icon_file_path = thumbnail_path;
-                } else if(content_type.starts_with("image/") || extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp") {
-                    icon_file_path = entry.path(); // This might be incredibly inefficient, but it will work for now
-                } else if(std::filesystem::exists(icon_file_path)) {
+                const bool has_thumbnail = thumbnail_is_valid && !thumbnail_path.empty();
+                if(std::filesystem::exists(icon_file_path)) {
                     // do nothing here, we already have a specialized icon for this file type
                 } else if(auto r = utils::resolve_icon(info->get_symbolic_icon().get())) {
                     icon_file_path = *r;
@@ -123,10 +124,27 @@ namespace menu {
                         "icons"/(entry.is_directory() ? "icon_files_folder.png" : "icon_files_file.png");
                 }
 
+                // images and existing thumbnails are scaled down on the thumbnailer's threads, the icon above is only used if that fails
+                std::optional<app::thumbnailer::request> thumbnail;
+                if(entry.is_regular_file() && (has_thumbnail ||
+                    content_type.starts_with("image/") || extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp"))
+                {
+                    thumbnail = xmb->get_thumbnailer().create(entry.path(), file->get_uri(), info->get_attribute_uint64("time::modified"),
+                        xmb->get_thumbnail_size(), has_thumbnail ? std::filesystem::path(thumbnail_path) : std::filesystem::path{});
+                }
+
                 if(entry.is_directory()) {
                     auto menu = make_simple<files_menu>(entry.path().filename().string(), icon_file_path, loader, xmb, entry.path(), loader);
                     entries.push_back(std::move(menu));
                 }
+                else if(thumbnail) {
+                    auto menu = std::make_unique<thumbnail_menu_entry>(entry.path().filename().string(),
+                        dreamrender::texture(loader.getDevice(), loader.getAllocator()));
+                    extra_data_entries.push_back({entry.path(), file, info, std::move(thumbnail), icon_file_path, menu.get()});
+                    entries.push_back(std::move(menu));
+                    all_files.insert(entry.path());
+                    continue;
+                }
                 else if (entry.is_regular_file()) {
                     auto menu = make_simple<simple_menu_entry>(entry.path().filename().string(), icon_file_path, loader);
                     entries.push_back(std::move(menu));
@@ -172,6 +190,27 @@ namespace menu {
         }
     }
 
+    bool files_menu::poll() {
+        for(auto& e : extra_data_entries) {
+            if(e.thumbnail && e.thumbnail->is_ready()) {
+                if(const auto& image = e.thumbnail->get()) {
+                    e.entry->thumbnail = xmb->get_icon_atlas().add(image->width, image->height, image->pixels);
+                }
+                if(!e.entry->thumbnail) {
+                    loader.loadTexture(&e.entry->get_icon(), e.fallback_icon);
+                }
+                e.thumbnail.reset();
+            }
+        }
+        // only the selected folder can be open, its own folders are polled by it
+        if(is_open && selected_submenu < entries.size()) {
+            if(auto* folder = dynamic_cast<menu*>(entries[selected_submenu].get())) {
+                folder->poll();
+            }
+        }
+        return false;
+    }
+
     void files_menu::resort() {
         if(selected_submenu < extra_data_entries.size()) {
             old_selected_item = extra_data_entries[selected_submenu].path;
@@ -371,13 +410,13 @@ namespace menu {
         return false;
     }
 
-    void files_menu::get_button_actions(std::vector<std::pair<action, std::string>>& v) {
+    void files_menu::get_button_actions(std::pmr::vector<std::pair<action, std::pmr::string>>& v) {
         if(!v.empty()) {
             return;
         }
         v.emplace_back(action::none, "");
         v.emplace_back(action::none, "");
-        v.emplace_back(action::options, "Options"_());
-        v.emplace_back(action::extra, "Sort and Filter"_());
+        v.emplace_back(action::options, std::string_view{"Options"_});
+        v.emplace_back(action::extra, std::string_view{"Sort and Filter"_});
     }
 }
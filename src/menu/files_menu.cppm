@@ -18,6 +18,9 @@ module;
 
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -28,9 +31,11 @@ import glibmm;
 import giomm;
 import dreamrender;
 import xmbshell.config;
+import xmbshell.render;
 import xmbshell.utils;
 import :menu_base;
 import :menu_utils;
+import :thumbnailer;
 
 namespace app {
     class xmbshell;
@@ -38,6 +43,20 @@ namespace app {
 
 export namespace menu {
 
+// An image in a folder, which is drawn from the icon atlas once its thumbnail is there.
+class thumbnail_menu_entry : public simple_menu_entry {
+    public:
+        using simple_menu_entry::simple_menu_entry;
+        ~thumbnail_menu_entry() override = default;
+
+        const render::icon_atlas::icon* get_atlas_icon() const override {
+            return thumbnail.get();
+        }
+    private:
+        std::unique_ptr<render::icon_atlas::icon> thumbnail;
+        friend class files_menu;
+};
+
 class files_menu : public simple_menu {
     public:
         files_menu(std::string name, dreamrender::texture&& icon, app::xmbshell* xmb, std::filesystem::path path, dreamrender::resource_loader& loader);
@@ -57,8 +76,9 @@ class files_menu : public simple_menu {
             return is_open ? entries.size() : 1;
         }
         result activate(action action) override;
+        bool poll() override;
 
-        void get_button_actions(std::vector<std::pair<action, std::string>>& v) override;
+        void get_button_actions(std::pmr::vector<std::pair<action, std::pmr::string>>& v) override;
 
         static constexpr auto filter_all = [](const Gio::FileInfo&) { return true; };
         static constexpr auto filter_visible = [](const Gio::FileInfo& info) {
@@ -101,6 +121,11 @@ class files_menu : public simple_menu {
             std::filesystem::path path;
             Glib::RefPtr<Gio::File> file;
             Glib::RefPtr<Gio::FileInfo> info;
+
+            // for images, the thumbnail is put into the icon atlas once it is there, the fallback icon is only loaded if it failed
+            std::optional<app::thumbnailer::request> thumbnail = std::nullopt;
+            std::filesystem::path fallback_icon = {};
+            thumbnail_menu_entry* entry = nullptr;
         };
         std::vector<extra_data> extra_data_entries;
 
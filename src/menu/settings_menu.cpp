@@ -418,6 +418,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
                 entry_bool(loader, xmb, "VSync"_(), "Avoid tearing and limit FPS to refresh rate of display"_(), "re.jcm.xmbos.xmbshell.render", "vsync"),
                 entry_int(loader, xmb, "Sample Count"_(), "Number of samples used for Multisample Anti-Aliasing"_(), "re.jcm.xmbos.xmbshell.render", "sample-count", std::array{1, 2, 4, 8, 16}),
                 entry_int(loader, xmb, "Max FPS"_(), "FPS limit used if VSync is disabled"_(), "re.jcm.xmbos.xmbshell.render", "max-fps", 15, 200, 5),
+                entry_bool(loader, xmb, "On-demand Rendering"_(), "Only render new frames if something on screen changed"_(), "re.jcm.xmbos.xmbshell.render", "on-demand-rendering"),
+                entry_bool(loader, xmb, "Adaptive Quality"_(), "Lower the quality of the background to keep up with the frame rate"_(), "re.jcm.xmbos.xmbshell.render", "adaptive-quality"),
+                entry_double(loader, xmb, "Background Resolution"_(), "Render the wave background at a fraction of the screen resolution"_(), "re.jcm.xmbos.xmbshell.render", "background-scale", 0.25, 1.0, 0.25),
+                entry_int(loader, xmb, "Background Update Rate"_(), "How many times per second the wave background is rendered (0 for every frame)"_(), "re.jcm.xmbos.xmbshell.render", "background-rate", std::array{0, 10, 15, 20, 30, 60}),
             }
         ));
         entries.push_back(make_simple<simple_menu>("Input Settings"_(), asset_dir/"icons/icon_settings_input.png", loader,
@@ -440,6 +444,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
             std::array{
                 entry_bool(loader, xmb, "Show FPS"_(), "", "re.jcm.xmbos.xmbshell.render", "show-fps"),
                 entry_bool(loader, xmb, "Show Memory Usage"_(), "", "re.jcm.xmbos.xmbshell.render", "show-mem"),
+                entry_bool(loader, xmb, "Show Performance HUD"_(), "", "re.jcm.xmbos.xmbshell.render", "show-perf"),
                 make_simple<action_menu_entry>("Toggle Background Blur"_(), asset_dir/"icons/icon_settings_toggle-background-blur.png", loader, [xmb](){
                     spdlog::info("Toggling background blur");
                     xmb->set_blur_background(!xmb->get_blur_background());
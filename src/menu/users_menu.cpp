@@ -16,6 +16,7 @@
  */
 module;
 
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <string>
@@ -41,7 +42,37 @@ import i18n;
 namespace menu {
     using namespace mfk::i18n::literals;
 
-    users_menu::users_menu(std::string name, dreamrender::texture&& icon, app::xmbshell* xmb, dreamrender::resource_loader& loader) : simple_menu(std::move(name), std::move(icon)) {
+    users_menu::users_menu(std::string name, dreamrender::texture&& icon, app::xmbshell* xmb, dreamrender::resource_loader& loader) :
+        async_menu(std::move(name), std::move(icon),
+            make_simple<simple_menu_entry>("Loading..."_(), config::CONFIG.asset_directory/"icons/icon_user.png", loader)),
+        loader(loader)
+    {
+        // the D-Bus round trips to AccountsService and logind can take a while.
+        // The settings can be reloaded while the provider runs, so it gets its own copy of the asset directory.
+        populate([this, xmb, icons = config::CONFIG.asset_directory/"icons"]{
+            return load_entries(xmb, icons);
+        });
+    }
+
+    bool users_menu::poll() {
+        if(!async_menu::poll()) {
+            return false;
+        }
+        // the entries are gone if the provider failed
+        for(std::size_t i = 0; i < entries.size() && i < loaded_icons.size(); i++) {
+            loader.loadTexture(&static_cast<simple_menu_entry&>(*entries[i]).get_icon(), loaded_icons[i]);
+        }
+        loaded_icons.clear();
+        return true;
+    }
+
+    template<typename Entry, typename... Args>
+    std::unique_ptr<Entry> users_menu::create_entry(std::string name, Args&&... args) const {
+        return std::make_unique<Entry>(std::move(name), dreamrender::texture(loader.getDevice(), loader.getAllocator()), std::forward<Args>(args)...);
+    }
+
+    users_menu::entry_list users_menu::load_entries(app::xmbshell* xmb, const std::filesystem::path& icons) {
+        entry_list entries;
         try {
             login1 = Gio::DBus::Proxy::create_for_bus_sync(Gio::DBus::BusType::SYSTEM, "org.freedesktop.login1", "/org/freedesktop/login1", "org.freedesktop.login1.Manager");
             accounts = Gio::DBus::Proxy::create_for_bus_sync(Gio::DBus::BusType::SYSTEM, "org.freedesktop.Accounts", "/org/freedesktop/Accounts", "org.freedesktop.Accounts");
@@ -65,14 +96,16 @@ namespace menu {
                 std::filesystem::path icon_file_path = static_cast<std::string>(icon_file.get());
                 std::error_code ec;
                 if(!std::filesystem::exists(icon_file_path, ec) || ec) {
-                    icon_file_path = config::CONFIG.asset_directory/"icons/icon_user.png";
+                    icon_file_path = icons/"icon_user.png";
                 }
-                auto entry = make_simple<simple_menu_entry>(real_name.get(), icon_file_path, loader);
+                auto entry = create_entry<simple_menu_entry>(real_name.get());
 
                 if(uid.get() == my_uid) { // the current user is always first
                     entries.insert(entries.begin(), std::move(entry));
+                    loaded_icons.insert(loaded_icons.begin(), std::move(icon_file_path));
                 } else {
                     entries.push_back(std::move(entry));
+                    loaded_icons.push_back(std::move(icon_file_path));
                 }
             }
         } catch (const std::exception& e) {
@@ -80,7 +113,8 @@ namespace menu {
         }
 #endif
 
-        entries.push_back(make_simple<action_menu_entry>("Quit"_(), config::CONFIG.asset_directory/"icons/icon_action_quit.png", loader, [xmb](){
+        loaded_icons.push_back(icons/"icon_action_quit.png");
+        entries.push_back(create_entry<action_menu_entry>("Quit"_(), [xmb](){
             xmb->emplace_overlay<app::message_overlay>("Quit"_(), "Do you really want to quit the application?"_(),
                 std::vector<std::string>{"Yes"_(), "No"_()}, [xmb](unsigned int choice){
                     if(choice == 0) {
@@ -99,7 +133,8 @@ namespace menu {
 
         if(login1) try {
             if(Glib::Variant<Glib::ustring> v; login1->call_sync("CanPowerOff", Glib::VariantContainerBase{}).get_child(v), v.get() == "yes") {
-                entries.push_back(make_simple<action_menu_entry>("Power off"_(), config::CONFIG.asset_directory/"icons/icon_action_poweroff.png", loader, [this, xmb](){
+                loaded_icons.push_back(icons/"icon_action_poweroff.png");
+                entries.push_back(create_entry<action_menu_entry>("Power off"_(), [this, xmb](){
                     xmb->emplace_overlay<app::message_overlay>("Power off"_(), "Do you really want to power off the system?"_(),
                         std::vector<std::string>{"Yes"_(), "No"_()}, [this](unsigned int choice){
                             if(choice == 0) {
@@ -111,7 +146,8 @@ namespace menu {
                 }));
             }
             if(Glib::Variant<Glib::ustring> v; login1->call_sync("CanReboot", Glib::VariantContainerBase{}).get_child(v), v.get() == "yes") {
-                entries.push_back(make_simple<action_menu_entry>("Reboot"_(), config::CONFIG.asset_directory/"icons/icon_action_reboot.png", loader, [this, xmb](){
+                loaded_icons.push_back(icons/"icon_action_reboot.png");
+                entries.push_back(create_entry<action_menu_entry>("Reboot"_(), [this, xmb](){
                     xmb->emplace_overlay<app::message_overlay>("Reboot"_(), "Do you really want to reboot the system?"_(),
                         std::vector<std::string>{"Yes"_(), "No"_()}, [this](unsigned int choice){
                             if(choice == 0) {
@@ -123,7 +159,8 @@ namespace menu {
                 }));
             }
             if(Glib::Variant<Glib::ustring> v; login1->call_sync("CanSuspend", Glib::VariantContainerBase{}).get_child(v), v.get() == "yes") {
-                entries.push_back(make_simple<action_menu_entry>("Suspend"_(), config::CONFIG.asset_directory/"icons/icon_action_suspend.png", loader, [this, xmb](){
+                loaded_icons.push_back(icons/"icon_action_suspend.png");
+                entries.push_back(create_entry<action_menu_entry>("Suspend"_(), [this, xmb](){
                     xmb->emplace_overlay<app::message_overlay>("Suspend"_(), "Do you really want to suspend the system?"_(),
                         std::vector<std::string>{"Yes"_(), "No"_()}, [this](unsigned int choice){
                             if(choice == 0) {
@@ -137,5 +174,6 @@ namespace menu {
         } catch (const std::exception& e) {
             spdlog::error("Failed to get power management information: {}", static_cast<std::string>(e.what()));
         }
+        return entries;
     }
 }
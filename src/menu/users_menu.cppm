@@ -16,7 +16,10 @@
  */
 module;
 
+#include <filesystem>
+#include <memory>
 #include <string>
+#include <vector>
 
 export module xmbshell.app:users_menu;
 
@@ -32,12 +35,25 @@ namespace app {
 
 export namespace menu {
 
-class users_menu : public simple_menu {
+class users_menu : public async_menu {
     public:
         users_menu(std::string name, dreamrender::texture&& icon, app::xmbshell* xmb, dreamrender::resource_loader& loader);
-        ~users_menu() override = default;
+        ~users_menu() override {
+            wait();
+        }
+
+        bool poll() override;
     private:
+        entry_list load_entries(app::xmbshell* xmb, const std::filesystem::path& icons);
+        // The entry starts without its icon, the loader has to be called on the main thread.
+        template<typename Entry, typename... Args>
+        std::unique_ptr<Entry> create_entry(std::string name, Args&&... args) const;
+
+        dreamrender::resource_loader& loader;
+
+        // only written while the entries are loaded, the entries use them afterwards
         Glib::RefPtr<Gio::DBus::Proxy> login1, accounts;
+        std::vector<std::filesystem::path> loaded_icons; // written by the provider, one per entry, loaded in poll()
 };
 
 }
@@ -38,6 +38,10 @@ export class base_viewer {
             offset = glm::clamp(offset + move_delta_pos, -limit, limit);
         }
 
+        bool is_moving() const {
+            return move_delta_pos != glm::vec2(0.0f, 0.0f);
+        }
+
         void render(vk::ImageView view, float size, dreamrender::gui_renderer& renderer) {
             float bw = size*renderer.aspect_ratio;
             float bh = size;
@@ -99,6 +99,12 @@ export class image_viewer : private base_viewer, public component, public action
             // Maybe one day the entire program will explode due to this, oh well!
             return texture->loaded;
         }
+        [[nodiscard]] bool is_animated() const override {
+            return !texture->loaded || base_viewer::is_moving();
+        }
+        [[nodiscard]] bool is_loaded() const override {
+            return texture->loaded;
+        }
     private:
         std::filesystem::path path;
         std::shared_ptr<dreamrender::texture> texture;
@@ -217,8 +217,8 @@ export class text_viewer : public component, public action_receiver {
                 renderer.draw_text(part, x, y, font_size);
                 for(const auto& h : hyperlinks) {
                     float hy = y + (h.line+1) * font_size/2.0f;
-                    float hx = x + renderer.measure_text(part.substr(h.pos - h.col, h.col), font_size).x;
-                    float hl = renderer.measure_text(h.dest, font_size).x;
+                    float hx = x + measure_text(xmb, renderer, part.substr(h.pos - h.col, h.col), font_size).x;
+                    float hl = measure_text(xmb, renderer, h.dest, font_size).x;
                     float hw = (h.hovered ? 3.0 : 1.0) / renderer.frame_size.height;
                     renderer.draw_rect(glm::vec2{hx, hy}, glm::vec2{hl, hw});
                     h.screen_pos = glm::vec2{hx, hy - font_size/2};
@@ -226,6 +226,7 @@ export class text_viewer : public component, public action_receiver {
                 }
             }
             renderer.reset_clip();
+            drawn = true;
         }
 
         result tick(xmbshell*) override {
@@ -291,6 +292,13 @@ export class text_viewer : public component, public action_receiver {
         bool enable_cursor() const override {
             return true;
         }
+        bool is_animated() const override {
+            return line_movement != 0;
+        }
+        bool is_loaded() const override {
+            // the file is read in the constructor, but its first page is only laid out when it is drawn
+            return drawn;
+        }
     private:
         static constexpr float width = 0.6f;
         static constexpr float height = 0.6f;
@@ -304,6 +312,7 @@ export class text_viewer : public component, public action_receiver {
         unsigned int lines = 0;
         int line_movement = 0;
         std::vector<hyperlink> hyperlinks;
+        bool drawn = false;
 
         unsigned int begin_offset = 0;
         unsigned int end_offset = 0;
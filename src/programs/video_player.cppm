@@ -32,6 +32,7 @@ import avcpp;
 import vulkan_hpp;
 import vma;
 import i18n;
+import xmbshell.trace;
 import xmbshell.utils;
 import :component;
 import :programs;
@@ -52,6 +53,7 @@ export class video_player : private base_viewer, public component, public action
             path(std::move(path)), device(loader.getDevice()), allocator(loader.getAllocator())
         {
             load_future = std::async(std::launch::async, [this, &loader] -> std::unique_ptr<video_decoding_context> {
+                trace::scope span("open video");
                 auto ctx = std::make_unique<video_decoding_context>();
                 try {
                     ctx->ictx.openInput(this->path.string());
@@ -155,26 +157,12 @@ export class video_player : private base_viewer, public component, public action
                     unormView = device.createImageViewUnique(vk::ImageViewCreateInfo({}, decoded_image.get(), vk::ImageViewType::e2D, vk::Format::eR8G8B8A8Unorm,
                         vk::ComponentMapping(), vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)));
 
-                    std::array<vk::DescriptorSetLayoutBinding, 4> bindings = {
-			            vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
-		            	vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
-		            	vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
-		            	vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute)
-		            };
-		            descriptorSetLayout = device.createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, bindings));
-
+                    // created at startup, so opening a video does not have to wait for the pipeline
+                    yuv420p = &xmb->get_yuv420p_pipeline();
                     vk::DescriptorPoolSize pool_size(vk::DescriptorType::eStorageImage, 4);
                     descriptorPool = device.createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo({}, 1, pool_size));
-                    descriptorSet = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), descriptorSetLayout.get())).front();
-
-                    pipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo({}, descriptorSetLayout.get()));
-                    vk::UniqueShaderModule shaderModule = render::shaders::yuv420p::decode_comp(device);
-                    vk::PipelineShaderStageCreateInfo shaderInfo({}, vk::ShaderStageFlagBits::eCompute, shaderModule.get(), "main");
-                    auto [r, p] = device.createComputePipelineUnique({}, vk::ComputePipelineCreateInfo({}, shaderInfo, pipelineLayout.get())).asTuple();
-                    if(r != vk::Result::eSuccess) {
-                        throw std::runtime_error("Failed to create compute pipeline");
-                    }
-                    this->pipeline = std::move(p);
+                    auto layout = yuv420p->get_descriptor_set_layout();
+                    descriptorSet = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), layout)).front();
 
                     plane_textures[0] = std::make_unique<dreamrender::texture>(device, allocator, image_width, image_height, vk::ImageUsageFlagBits::eStorage, vk::Format::eR8Unorm);
                     plane_textures[1] = std::make_unique<dreamrender::texture>(device, allocator, image_width/2, image_height/2, vk::ImageUsageFlagBits::eStorage, vk::Format::eR8Unorm);
@@ -228,6 +216,7 @@ export class video_player : private base_viewer, public component, public action
 
                 av::VideoFrame videoFrame;
                 try {
+                    trace::scope span("decode video frame");
                     videoFrame = ctx->vdec.decode(pkt);
                 } catch(const std::exception& e) {
                     spdlog::warn("Failed to decode video frame @ {}s: {}", decoded_timestamp, e.what());
@@ -312,8 +301,8 @@ export class video_player : private base_viewer, public component, public action
                             )
                         }
                     );
-                    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline.get());
-                    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout.get(), 0, descriptorSet, {});
+                    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, yuv420p->get_pipeline());
+                    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, yuv420p->get_pipeline_layout(), 0, descriptorSet, {});
                     cmd.dispatch((image_width+31)/16/2, (image_height+31)/16/2, 1);
                     cmd.pipelineBarrier(
                         vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader,
@@ -441,6 +430,12 @@ export class video_player : private base_viewer, public component, public action
         [[nodiscard]] bool is_opaque() const override {
             return loaded;
         }
+        [[nodiscard]] bool is_animated() const override {
+            return state == play_state::loading || state == play_state::playing || base_viewer::is_moving();
+        }
+        [[nodiscard]] bool is_loaded() const override {
+            return loaded;
+        }
     private:
         vk::Device device;
         vma::Allocator allocator;
@@ -464,9 +459,7 @@ export class video_player : private base_viewer, public component, public action
 
         bool yuv_conversion = false;
         std::array<std::unique_ptr<dreamrender::texture>, 3> plane_textures;
-        vk::UniquePipelineLayout pipelineLayout;
-        vk::UniquePipeline pipeline;
-        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+        const render::yuv420p_pipeline* yuv420p = nullptr;
         vk::UniqueDescriptorPool descriptorPool;
         vk::DescriptorSet descriptorSet;
         vk::UniqueImageView unormView;
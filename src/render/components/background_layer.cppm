@@ -0,0 +1,112 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+export module xmbshell.render:background_layer;
+
+import dreamrender;
+
+import vulkan_hpp;
+import vma;
+
+namespace render {
+
+/* An offscreen image the background is rendered into at a fraction of the frame's resolution,
+ * so it can be redrawn less often than the UI on top of it and composited with a (linear) upscale.
+ *
+ * It renders with a render pass like the shell's background render pass: attachment 0 is a multisampled color image,
+ * attachment 1 the single sampled image it is resolved into, which ends up in ShaderReadOnlyOptimal.
+ * There is one resolve target per frame in flight, so a new background never overwrites the one a previous frame still shows.
+ * The multisampled image is only used while rendering and is shared by all of them.
+ */
+export class background_layer {
+    public:
+        background_layer(vk::Device device, vma::Allocator allocator, vk::RenderPass renderPass, vk::Extent2D frameExtent,
+            vk::Format format, vk::SampleCountFlagBits sampleCount, float scale, unsigned int slotCount)
+            : scale(scale), extent(
+                std::max(1u, static_cast<unsigned int>(std::lround(static_cast<float>(frameExtent.width) * scale))),
+                std::max(1u, static_cast<unsigned int>(std::lround(static_cast<float>(frameExtent.height) * scale))))
+        {
+            multisampled = std::make_unique<dreamrender::texture>(device, allocator, extent,
+                vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransientAttachment,
+                format, sampleCount, false, vk::ImageAspectFlagBits::eColor);
+            dreamrender::debugName(device, multisampled->image, "Background Layer Render Image");
+            for(unsigned int i = 0; i < slotCount; i++) {
+                auto& target = targets.emplace_back(std::make_unique<dreamrender::texture>(device, allocator, extent,
+                    vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
+                    format, vk::SampleCountFlagBits::e1, false, vk::ImageAspectFlagBits::eColor));
+                dreamrender::debugName(device, target->image, "Background Layer #"+std::to_string(i));
+
+                std::array<vk::ImageView, 2> attachments = {multisampled->imageView.get(), target->imageView.get()};
+                vk::FramebufferCreateInfo framebuffer_info({}, renderPass, attachments, extent.width, extent.height, 1);
+                framebuffers.push_back(device.createFramebufferUnique(framebuffer_info));
+                dreamrender::debugName(device, framebuffers.back().get(), "Background Layer Framebuffer #"+std::to_string(i));
+            }
+        }
+
+        float get_scale() const {
+            return scale;
+        }
+        vk::Extent2D get_extent() const {
+            return extent;
+        }
+
+        // Begins "renderPass" on the target of "slot", with viewport and scissor covering the whole layer.
+        void begin(vk::CommandBuffer cmd, unsigned int slot, vk::RenderPass renderPass, vk::ClearValue clear) {
+            // the target might still be sampled by the frame that last used this slot's result
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, {}, {}, {});
+            cmd.beginRenderPass(vk::RenderPassBeginInfo(renderPass, framebuffers.at(slot).get(),
+                vk::Rect2D({0, 0}, extent), clear), vk::SubpassContents::eInline);
+            vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f);
+            cmd.setViewport(0, viewport);
+            cmd.setScissor(0, vk::Rect2D({0, 0}, extent));
+        }
+        // Ends the render pass, "slot" then holds the latest background.
+        void end(vk::CommandBuffer cmd, unsigned int slot) {
+            cmd.endRenderPass();
+            latest = static_cast<int>(slot);
+        }
+
+        bool has_result() const {
+            return latest >= 0;
+        }
+        // The latest background in ShaderReadOnlyOptimal.
+        vk::ImageView get_result() const {
+            return targets.at(latest)->imageView.get();
+        }
+        // Forgets the latest background, so the next frame has to render it again.
+        void invalidate() {
+            latest = -1;
+        }
+    private:
+        float scale;
+        vk::Extent2D extent;
+
+        std::unique_ptr<dreamrender::texture> multisampled;
+        std::vector<std::unique_ptr<dreamrender::texture>> targets;
+        std::vector<vk::UniqueFramebuffer> framebuffers;
+        int latest = -1;
+};
+
+}
@@ -0,0 +1,319 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+export module xmbshell.render:blur_pass;
+
+import dreamrender;
+import :shaders;
+
+import spdlog;
+import vulkan_hpp;
+import vma;
+
+namespace render {
+
+/* Blurs an image with a dual filter (shaders/dual_filter.comp) at a fraction of its resolution.
+ * The source is blitted into a target with half its size, downsampled to 1/4 and 1/8 and upsampled back to 1/2 again.
+ * Every pass reads one target and writes the next one, so the targets are ping-ponged by binding them differently
+ * in each pass' descriptor set and nothing has to be copied between passes.
+ *
+ * With a downscale (see set_downscale), the pyramid starts at a quarter or less of the source size instead.
+ *
+ * There is one independent slot (targets + descriptor sets) per frame that can blur at the same time.
+ * The targets of a slot are only allocated once it blurs something and released again after "release_timeout" without a blur.
+ */
+export class blur_pass {
+    public:
+        constexpr static unsigned int levels = 3; // 1/2, 1/4 and 1/8 of the source size
+        // Gives the same spread as the old 41x41 box blur (blur size 20) at 1/2 resolution.
+        constexpr static float default_offset = 2.85f;
+        constexpr static auto release_timeout = std::chrono::seconds(10);
+
+        blur_pass(vk::Device device, vma::Allocator allocator, vk::Extent2D sourceExtent, unsigned int slotCount = 1)
+            : device(device), allocator(allocator), sourceExtent(sourceExtent), slots(slotCount) {}
+
+        // Everything that does not depend on the size of the source, so several blur passes can share it.
+        struct pipeline_set {
+            vk::UniqueSampler sampler;
+            vk::UniqueDescriptorSetLayout descriptorSetLayout;
+            vk::UniquePipelineLayout pipelineLayout;
+            vk::UniquePipeline downPipeline, upPipeline;
+        };
+
+        // Can be called from any thread, the pipeline cache is synchronized by the driver.
+        static std::shared_ptr<const pipeline_set> create_pipelines(vk::Device device, vk::PipelineCache pipelineCache = {}) {
+            auto set = std::make_shared<pipeline_set>();
+            {
+                vk::SamplerCreateInfo info({}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest,
+                    vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge);
+                set->sampler = device.createSamplerUnique(info);
+            }
+            {
+                std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+                    vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute),
+                    vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+                };
+                vk::DescriptorSetLayoutCreateInfo info({}, bindings);
+                set->descriptorSetLayout = device.createDescriptorSetLayoutUnique(info);
+            }
+            {
+                vk::PushConstantRange range{vk::ShaderStageFlagBits::eCompute, 0, sizeof(push_constants)};
+                vk::PipelineLayoutCreateInfo info({}, set->descriptorSetLayout.get(), range);
+                set->pipelineLayout = device.createPipelineLayoutUnique(info);
+            }
+            {
+                vk::UniqueShaderModule compShader = shaders::dual_filter::comp(device);
+                vk::SpecializationMapEntry entry(0, 0, sizeof(vk::Bool32));
+                for(vk::Bool32 upsample : {0u, 1u}) {
+                    vk::SpecializationInfo spec_info(1, &entry, sizeof(upsample), &upsample);
+                    vk::PipelineShaderStageCreateInfo shader({}, vk::ShaderStageFlagBits::eCompute, compShader.get(), "main", &spec_info);
+                    vk::ComputePipelineCreateInfo info({}, shader, set->pipelineLayout.get());
+                    auto& pipeline = upsample ? set->upPipeline : set->downPipeline;
+                    pipeline = device.createComputePipelineUnique(pipelineCache, info).value;
+                    dreamrender::debugName(device, pipeline.get(), upsample ? "Blur Pipeline (up)" : "Blur Pipeline (down)");
+                }
+            }
+            return set;
+        }
+
+        void preload(vk::PipelineCache pipelineCache = {}) {
+            preload(create_pipelines(device, pipelineCache));
+        }
+        void preload(std::shared_ptr<const pipeline_set> pipelines) {
+            this->pipelines = std::move(pipelines);
+            create_descriptor_pool();
+        }
+
+        /* Changes the size of the source and the number of slots, while keeping the pipelines.
+         * All targets are released and allocated again at the new size once their slot blurs something,
+         * so no frame in flight may still use one of them.
+         */
+        void resize(vk::Extent2D sourceExtent, unsigned int slotCount) {
+            for(auto& s : slots) {
+                release(s);
+            }
+            this->sourceExtent = sourceExtent;
+            if(slotCount != slots.size()) {
+                slots.clear();
+                slots.resize(slotCount);
+                create_descriptor_pool();
+            }
+        }
+
+        /* Starts the pyramid at 1/2^(downscale+1) of the source size, which makes the blur cheaper and blockier.
+         * The offset is scaled down with it, so the spread stays about the same.
+         * Like resize(), all targets are released, so no frame in flight may still use one of them.
+         */
+        void set_downscale(unsigned int downscale) {
+            if(downscale == this->downscale) {
+                return;
+            }
+            for(auto& s : slots) {
+                release(s);
+            }
+            this->downscale = downscale;
+        }
+        unsigned int get_downscale() const {
+            return downscale;
+        }
+
+        /* Records the blur of "source" (of size "sourceExtent", currently in "sourceLayout" and written in "sourceStage") into "slot".
+         * The source is left in TransferSrcOptimal, the result (see get_result) can be sampled in fragment shaders afterwards.
+         */
+        void record(vk::CommandBuffer cmd, unsigned int slot, vk::Image source, vk::ImageLayout sourceLayout,
+            vk::PipelineStageFlags sourceStage, vk::AccessFlags sourceAccess, float offset = default_offset)
+        {
+            auto& s = slots.at(slot);
+            allocate(s);
+            s.last_used = std::chrono::steady_clock::now();
+
+            auto range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+            // the result of the last blur in this slot might still be read by a previous frame
+            cmd.pipelineBarrier(sourceStage | vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, {
+                vk::ImageMemoryBarrier(sourceAccess, vk::AccessFlagBits::eTransferRead,
+                    sourceLayout, vk::ImageLayout::eTransferSrcOptimal,
+                    vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, source, range),
+                vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eTransferWrite,
+                    vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                    vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, s.targets[0]->image, range),
+            });
+            cmd.blitImage(source, vk::ImageLayout::eTransferSrcOptimal,
+                s.targets[0]->image, vk::ImageLayout::eTransferDstOptimal,
+                vk::ImageBlit(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+                    {vk::Offset3D(0, 0, 0), vk::Offset3D(static_cast<int>(sourceExtent.width), static_cast<int>(sourceExtent.height), 1)},
+                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+                    {vk::Offset3D(0, 0, 0), vk::Offset3D(s.targets[0]->width, s.targets[0]->height, 1)}),
+                vk::Filter::eLinear);
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, {
+                vk::ImageMemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                    vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                    vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, s.targets[0]->image, range),
+            });
+
+            push_constants constants{offset / static_cast<float>(1u << downscale)};
+            for(unsigned int pass = 0; pass < passes; pass++) {
+                bool upsample = pass >= levels-1;
+                auto [input, output] = pass_targets(pass);
+
+                // the output was either never written or has just been read by the previous pass
+                cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, {
+                    vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eShaderWrite,
+                        vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, s.targets[output]->image, range),
+                });
+
+                cmd.bindPipeline(vk::PipelineBindPoint::eCompute, upsample ? pipelines->upPipeline.get() : pipelines->downPipeline.get());
+                cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelines->pipelineLayout.get(), 0, s.descriptorSets[pass], {});
+                cmd.pushConstants(pipelines->pipelineLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, sizeof(push_constants), &constants);
+                cmd.dispatch((s.targets[output]->width + 15) / 16, (s.targets[output]->height + 15) / 16, 1);
+
+                bool last = pass == passes-1;
+                cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                    last ? vk::PipelineStageFlagBits::eFragmentShader : vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, {
+                    vk::ImageMemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead,
+                        vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, s.targets[output]->image, range),
+                });
+            }
+        }
+
+        vk::Extent2D get_source_extent() const {
+            return sourceExtent;
+        }
+        // The blurred image of "slot" (at half the source size, or less with a downscale) in ShaderReadOnlyOptimal.
+        vk::ImageView get_result(unsigned int slot = 0) const {
+            return slots.at(slot).targets[0]->imageView.get();
+        }
+        bool is_allocated(unsigned int slot = 0) const {
+            return static_cast<bool>(slots.at(slot).targets[0]);
+        }
+
+        /* Releases the targets of all slots (except "keep") that did not blur anything for "release_timeout",
+         * returns whether any were released.
+         * The timeout is much longer than any frame could be in flight, so the targets are no longer in use by then.
+         */
+        bool release_if_idle(std::optional<unsigned int> keep = std::nullopt) {
+            bool released = false;
+            auto now = std::chrono::steady_clock::now();
+            for(unsigned int i = 0; i < slots.size(); i++) {
+                auto& s = slots[i];
+                if(!s.targets[0] || i == keep || now - s.last_used < release_timeout) {
+                    continue;
+                }
+                release(s);
+                released = true;
+            }
+            if(released) {
+                spdlog::debug("Released blur targets after {} seconds without a blur", release_timeout.count());
+            }
+            return released;
+        }
+    private:
+        struct push_constants {
+            float offset;
+        };
+        constexpr static unsigned int passes = 2*(levels-1);
+
+        struct target_slot {
+            std::array<std::unique_ptr<dreamrender::texture>, levels> targets;
+            std::array<vk::DescriptorSet, passes> descriptorSets;
+            std::chrono::steady_clock::time_point last_used;
+        };
+
+        // downsampling 0 -> 1 -> 2, then upsampling 2 -> 1 -> 0
+        static std::pair<unsigned int, unsigned int> pass_targets(unsigned int pass) {
+            if(pass < levels-1) {
+                return {pass, pass+1};
+            }
+            unsigned int up = pass - (levels-1);
+            return {levels-1-up, levels-2-up};
+        }
+
+        void create_descriptor_pool() {
+            const unsigned int sets = passes * slots.size();
+            std::array sizes = {
+                vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, sets),
+                vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, sets),
+            };
+            vk::DescriptorPoolCreateInfo pool_info(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, sets, sizes);
+            descriptorPool = device.createDescriptorPoolUnique(pool_info);
+        }
+
+        void release(target_slot& s) {
+            if(!s.targets[0]) {
+                return;
+            }
+            device.freeDescriptorSets(descriptorPool.get(), s.descriptorSets);
+            s.descriptorSets = {};
+            for(auto& t : s.targets) {
+                t.reset();
+            }
+        }
+
+        void allocate(target_slot& s) {
+            if(s.targets[0]) {
+                return;
+            }
+            for(unsigned int i = 0; i < levels; i++) {
+                vk::Extent2D extent(
+                    std::max(1u, sourceExtent.width >> (i+1+downscale)),
+                    std::max(1u, sourceExtent.height >> (i+1+downscale)));
+                s.targets[i] = std::make_unique<dreamrender::texture>(device, allocator, extent,
+                    vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+                    vk::Format::eR16G16B16A16Sfloat, vk::SampleCountFlagBits::e1, false, vk::ImageAspectFlagBits::eColor);
+                dreamrender::debugName(device, s.targets[i]->image, "Blur Target 1/"+std::to_string(2<<(i+downscale)));
+            }
+
+            std::array<vk::DescriptorSetLayout, passes> layouts;
+            layouts.fill(pipelines->descriptorSetLayout.get());
+            auto sets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), layouts));
+            std::ranges::copy(sets, s.descriptorSets.begin());
+
+            std::array<vk::DescriptorImageInfo, 2*passes> infos;
+            std::array<vk::WriteDescriptorSet, 2*passes> writes;
+            for(unsigned int pass = 0; pass < passes; pass++) {
+                auto [input, output] = pass_targets(pass);
+                infos[2*pass] = vk::DescriptorImageInfo(pipelines->sampler.get(), s.targets[input]->imageView.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
+                infos[2*pass+1] = vk::DescriptorImageInfo({}, s.targets[output]->imageView.get(), vk::ImageLayout::eGeneral);
+                writes[2*pass] = vk::WriteDescriptorSet(s.descriptorSets[pass], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &infos[2*pass]);
+                writes[2*pass+1] = vk::WriteDescriptorSet(s.descriptorSets[pass], 1, 0, 1, vk::DescriptorType::eStorageImage, &infos[2*pass+1]);
+            }
+            device.updateDescriptorSets(writes, {});
+        }
+
+        vk::Device device;
+        vma::Allocator allocator;
+        vk::Extent2D sourceExtent;
+        unsigned int downscale = 0;
+
+        std::shared_ptr<const pipeline_set> pipelines;
+        vk::UniqueDescriptorPool descriptorPool;
+
+        std::vector<target_slot> slots;
+};
+
+}
@@ -0,0 +1,242 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+export module xmbshell.render:draw_list;
+
+import dreamrender;
+import :icon_atlas;
+import :quad_renderer;
+import :text_layout_cache;
+
+import glm;
+import vulkan_hpp;
+
+namespace render {
+
+/* Collects the images, rectangles and text a component draws and submits the images and rectangles
+ * as instanced batches of quad_renderer instead of one draw call each. Text is still drawn by the gui_renderer.
+ *
+ * Batches are formed by texture and clip: a quad joins the latest batch with the same texture and clip,
+ * unless it overlaps something that was added after that batch. Overlapping draws therefore keep the order
+ * they were added in, and push_color/set_clip apply to exactly the draws between them, like with gui_renderer.
+ * Everything is submitted by flush() or when the draw list is destroyed.
+ */
+export class draw_list {
+    public:
+        // Only the last entries are searched for a matching batch, so adding a quad stays cheap.
+        constexpr static std::size_t max_lookback = 64;
+
+        const float aspect_ratio;
+
+        // "base_color" is what the gui_renderer's own color stack currently multiplies everything with.
+        // Text is measured through "layouts" if it is given, everything the list stores is allocated from "memory".
+        draw_list(dreamrender::gui_renderer& renderer, quad_renderer& quads, vk::RenderPass renderPass, glm::vec4 base_color = glm::vec4(1.0f),
+            text_layout_cache* layouts = nullptr, std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+            : aspect_ratio(static_cast<float>(renderer.aspect_ratio)), renderer(renderer), quads(quads), renderPass(renderPass),
+              base_color(base_color), layouts(layouts), memory(memory), colors({glm::vec4(1.0f)}, memory), entries(memory) {}
+        ~draw_list() {
+            flush();
+        }
+        draw_list(const draw_list&) = delete;
+        draw_list& operator=(const draw_list&) = delete;
+
+        void push_color(glm::vec4 color) {
+            colors.push_back(colors.back() * color);
+        }
+        void pop_color() {
+            colors.pop_back();
+        }
+        void set_clip(float x, float y, float width, float height) {
+            clip = glm::vec4(x, y, width, height);
+        }
+        void reset_clip() {
+            clip.reset();
+        }
+
+        // The same coordinates as gui_renderer: "width" and "height" are relative to the height of the frame.
+        void draw_image(const dreamrender::texture& texture, float x, float y, float width, float height) {
+            if(!texture.loaded) {
+                return;
+            }
+            add_quad(texture.imageView.get(), glm::vec4(x, y, width/aspect_ratio, height), colors.back());
+        }
+        // Like draw_image, but keeps the aspect ratio of the texture and centers it in the given box.
+        void draw_image_a(const dreamrender::texture& texture, float x, float y, float width, float height) {
+            if(!texture.loaded || texture.width == 0 || texture.height == 0) {
+                return;
+            }
+            float texture_aspect = static_cast<float>(texture.width) / static_cast<float>(texture.height);
+            float w = width, h = height;
+            if(texture_aspect > width/height) {
+                h = width / texture_aspect;
+            } else {
+                w = height * texture_aspect;
+            }
+            draw_image(texture, x + (width-w)/2.0f/aspect_ratio, y + (height-h)/2.0f, w, h);
+        }
+        // Same as above for an icon from an icon_atlas, it is skipped until its upload has been recorded.
+        void draw_image(const icon_atlas::icon& icon, float x, float y, float width, float height) {
+            if(!icon.is_loaded()) {
+                return;
+            }
+            add_quad(icon.get_view(), glm::vec4(x, y, width/aspect_ratio, height), colors.back(), icon.get_uv());
+        }
+        void draw_image_a(const icon_atlas::icon& icon, float x, float y, float width, float height) {
+            float icon_aspect = static_cast<float>(icon.get_width()) / static_cast<float>(icon.get_height());
+            float w = width, h = height;
+            if(icon_aspect > width/height) {
+                h = width / icon_aspect;
+            } else {
+                w = height * icon_aspect;
+            }
+            draw_image(icon, x + (width-w)/2.0f/aspect_ratio, y + (height-h)/2.0f, w, h);
+        }
+        // "position" and "size" are relative to the frame, like gui_renderer::draw_rect.
+        void draw_rect(glm::vec2 position, glm::vec2 size, glm::vec4 color = glm::vec4(1.0f)) {
+            add_quad(vk::ImageView{}, glm::vec4(position, size), colors.back() * color);
+        }
+        void draw_text(std::string_view text, float x, float y, float size, glm::vec4 color = glm::vec4(1.0f),
+            bool center_horizontally = false, bool center_vertically = false)
+        {
+            // The text could be centered or not, so its box is extended to both sides.
+            glm::vec2 extent = measure_text(text, size);
+            entries.push_back(entry{
+                .bounds = glm::vec4(x - extent.x, y - extent.y, x + extent.x, y + extent.y),
+                .text = text_entry{std::pmr::string(text, memory), x, y, size, colors.back() * color, center_horizontally, center_vertically, clip},
+            });
+        }
+        glm::vec2 measure_text(std::string_view text, float size) {
+            return layouts ? layouts->measure(renderer, text, size) : renderer.measure_text(text, size);
+        }
+
+        // Submits everything added so far.
+        void flush() {
+            std::pmr::vector<quad_renderer::batch> batches(memory);
+            auto submit = [&]() {
+                if(batches.empty()) {
+                    return;
+                }
+                quads.draw(renderer.get_command_buffer(), renderer.get_frame(), renderPass, batches);
+                // gui_renderer expects the scissor it set up, i.e. the whole frame unless it is clipping itself
+                if(std::ranges::any_of(batches, [this](const auto& b) { return b.scissor != full_scissor(); })) {
+                    renderer.get_command_buffer().setScissor(0, full_scissor());
+                }
+                batches.clear();
+            };
+            for(const auto& e : entries) {
+                if(!e.text) {
+                    batches.push_back({e.texture, e.scissor, e.instances});
+                    continue;
+                }
+                submit();
+                const auto& t = *e.text;
+                if(t.clip) {
+                    renderer.set_clip(t.clip->x, t.clip->y, t.clip->z, t.clip->w);
+                }
+                renderer.draw_text(t.text, t.x, t.y, t.size, t.color, t.center_horizontally, t.center_vertically);
+                if(t.clip) {
+                    renderer.reset_clip();
+                }
+            }
+            submit();
+            entries.clear();
+        }
+    private:
+        struct text_entry {
+            std::pmr::string text;
+            float x, y, size;
+            glm::vec4 color; // without base_color, the gui_renderer applies that itself
+            bool center_horizontally, center_vertically;
+            std::optional<glm::vec4> clip;
+        };
+        struct entry {
+            glm::vec4 bounds; // min x, min y, max x, max y
+            std::optional<text_entry> text; // otherwise a batch of quads
+            vk::ImageView texture{};
+            vk::Rect2D scissor{};
+            std::pmr::vector<quad_renderer::instance> instances{};
+        };
+
+        static bool intersects(const glm::vec4& a, const glm::vec4& b) {
+            return a.x < b.z && b.x < a.z && a.y < b.w && b.y < a.w;
+        }
+
+        vk::Rect2D full_scissor() const {
+            return vk::Rect2D({0, 0}, renderer.frame_size);
+        }
+        vk::Rect2D current_scissor() const {
+            if(!clip) {
+                return full_scissor();
+            }
+            auto frame_size = glm::vec2(renderer.frame_size.width, renderer.frame_size.height);
+            glm::vec2 min = glm::clamp(glm::vec2(clip->x, clip->y) * frame_size, glm::vec2(0.0f), frame_size);
+            glm::vec2 max = glm::clamp(glm::vec2(clip->x + clip->z, clip->y + clip->w) * frame_size, glm::vec2(0.0f), frame_size);
+            return vk::Rect2D({static_cast<int32_t>(min.x), static_cast<int32_t>(min.y)},
+                {static_cast<uint32_t>(max.x - min.x), static_cast<uint32_t>(max.y - min.y)});
+        }
+
+        void add_quad(vk::ImageView texture, glm::vec4 rect, glm::vec4 color, glm::vec4 uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)) {
+            color *= base_color;
+            if(color.a <= 0.0f) {
+                return;
+            }
+            glm::vec4 bounds(rect.x, rect.y, rect.x + rect.z, rect.y + rect.w);
+            quad_renderer::instance instance{rect, uv, color};
+            vk::Rect2D scissor = current_scissor();
+
+            std::size_t searched = 0;
+            for(auto it = entries.rbegin(); it != entries.rend() && searched < max_lookback; ++it, ++searched) {
+                if(!it->text && it->texture == texture && it->scissor == scissor) {
+                    it->instances.push_back(instance);
+                    it->bounds = glm::vec4(glm::min(glm::vec2(it->bounds), glm::vec2(bounds)),
+                        glm::max(glm::vec2(it->bounds.z, it->bounds.w), glm::vec2(bounds.z, bounds.w)));
+                    return;
+                }
+                if(intersects(it->bounds, bounds)) {
+                    break;
+                }
+            }
+            entries.push_back(entry{
+                .bounds = bounds,
+                .texture = texture,
+                .scissor = scissor,
+                .instances = std::pmr::vector<quad_renderer::instance>({instance}, memory),
+            });
+        }
+
+        dreamrender::gui_renderer& renderer;
+        quad_renderer& quads;
+        vk::RenderPass renderPass;
+        glm::vec4 base_color;
+        text_layout_cache* layouts;
+        std::pmr::memory_resource* memory;
+
+        std::pmr::vector<glm::vec4> colors;
+        std::optional<glm::vec4> clip;
+        std::pmr::vector<entry> entries;
+};
+
+}
@@ -0,0 +1,205 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+export module xmbshell.render:gpu_timer;
+
+import spdlog;
+import vulkan_hpp;
+
+namespace render {
+
+/* Measures how long the passes of a frame take on the GPU with timestamp queries.
+ * Every frame in flight has its own range of queries. They are read back the next time the same frame is recorded,
+ * at which point its fence has been waited for, so reading them never stalls.
+ */
+export class gpu_timer {
+    public:
+        constexpr static unsigned int max_scopes = 32; // per frame
+        constexpr static auto log_interval = std::chrono::seconds(5);
+
+        struct result {
+            std::string name;
+            double milliseconds;
+        };
+
+        class scope {
+            public:
+                scope(gpu_timer* timer, vk::CommandBuffer cmd, int id) : timer(timer), cmd(cmd), id(id) {}
+                ~scope() {
+                    stop();
+                }
+                // Ends the measurement before the scope is left.
+                void stop() {
+                    if(timer) {
+                        timer->end(cmd, id);
+                        timer = nullptr;
+                    }
+                }
+                scope(const scope&) = delete;
+                scope& operator=(const scope&) = delete;
+            private:
+                gpu_timer* timer;
+                vk::CommandBuffer cmd;
+                int id;
+        };
+
+        gpu_timer(vk::Device device, vk::PhysicalDevice physicalDevice, unsigned int frames) : device(device), frames(frames) {
+            auto limits = physicalDevice.getProperties().limits;
+            timestampPeriod = limits.timestampPeriod;
+            supported = limits.timestampComputeAndGraphics;
+            if(!supported) {
+                spdlog::warn("GPU timestamps are not supported on this device, GPU timings will not be available");
+                return;
+            }
+            queryPool = device.createQueryPoolUnique(vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, 2*max_scopes*frames));
+            pending.resize(frames);
+            for(auto& names : pending) {
+                names.reserve(max_scopes);
+            }
+        }
+
+        /* Collects the results of the last time "frame" was recorded and resets its queries.
+         * Has to be called before any scope of the frame, outside of a render pass.
+         */
+        void begin_frame(vk::CommandBuffer cmd, int frame, bool enable) {
+            current = enable && supported ? frame : -1;
+            if(!supported) {
+                return;
+            }
+            collect(frame);
+            if(current < 0) {
+                return;
+            }
+            cmd.resetQueryPool(queryPool.get(), 2*max_scopes*frame, 2*max_scopes);
+        }
+
+        bool is_enabled() const {
+            return current >= 0;
+        }
+
+        /* Times the commands recorded into "cmd" until the returned scope is destroyed as the pass "name".
+         * "name" is not copied until the results are collected, so it has to be a string literal or otherwise outlive the frame.
+         */
+        [[nodiscard]] scope measure(vk::CommandBuffer cmd, std::string_view name) {
+            int id = begin(cmd, name);
+            return scope(id >= 0 ? this : nullptr, cmd, id);
+        }
+
+        int begin(vk::CommandBuffer cmd, std::string_view name) {
+            if(current < 0) {
+                return -1;
+            }
+            auto& names = pending[current];
+            if(names.size() >= max_scopes) {
+                return -1;
+            }
+            int id = static_cast<int>(names.size());
+            names.emplace_back(name);
+            cmd.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool.get(), query(current, id, false));
+            return id;
+        }
+        void end(vk::CommandBuffer cmd, int id) {
+            if(current < 0 || id < 0) {
+                return;
+            }
+            cmd.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool.get(), query(current, id, true));
+        }
+
+        // Smoothed time of every pass measured so far, in the order they were first seen.
+        const std::vector<result>& get_results() const {
+            return results;
+        }
+        std::optional<double> get_milliseconds(std::string_view name) const {
+            auto it = std::ranges::find(results, name, &result::name);
+            return it == results.end() ? std::nullopt : std::optional(it->milliseconds);
+        }
+    private:
+        unsigned int query(int frame, int id, bool end) const {
+            return 2*max_scopes*frame + 2*id + (end ? 1 : 0);
+        }
+
+        void collect(int frame) {
+            auto& names = pending[frame];
+            if(names.empty()) {
+                return;
+            }
+            std::array<uint64_t, 2*max_scopes> timestamps;
+            const auto count = static_cast<uint32_t>(2*names.size());
+            auto status = device.getQueryPoolResults(queryPool.get(), query(frame, 0, false), count,
+                count*sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+            if(status == vk::Result::eSuccess) {
+                // passes measured more than once per frame (e.g. one per overlay) are summed up into their first scope
+                std::array<double, max_scopes> sums{};
+                for(unsigned int i = 0; i < names.size(); i++) {
+                    double ms = static_cast<double>(timestamps[2*i+1] - timestamps[2*i]) * timestampPeriod / 1e6;
+                    sums[std::distance(names.begin(), std::ranges::find(names, names[i]))] += ms;
+                }
+                for(unsigned int i = 0; i < names.size(); i++) {
+                    if(std::ranges::find(names, names[i]) == names.begin() + i) {
+                        add(names[i], sums[i]);
+                    }
+                }
+                log();
+            }
+            names.clear();
+        }
+
+        void add(std::string_view name, double milliseconds) {
+            constexpr double smoothing = 0.1;
+            auto it = std::ranges::find(results, name, &result::name);
+            if(it == results.end()) {
+                results.push_back({std::string(name), milliseconds});
+            } else {
+                it->milliseconds += (milliseconds - it->milliseconds) * smoothing;
+            }
+        }
+
+        void log() {
+            auto now = std::chrono::steady_clock::now();
+            if(now - last_log < log_interval) {
+                return;
+            }
+            last_log = now;
+            for(const auto& r : results) {
+                spdlog::debug("GPU time of {}: {:.3f} ms", r.name, r.milliseconds);
+            }
+        }
+
+        vk::Device device;
+        unsigned int frames;
+        float timestampPeriod = 1.0f;
+        bool supported = false;
+        vk::UniqueQueryPool queryPool;
+
+        int current = -1;
+        std::vector<std::vector<std::string_view>> pending; // names of the scopes recorded per frame
+        std::vector<result> results;
+        std::chrono::steady_clock::time_point last_log;
+};
+
+}
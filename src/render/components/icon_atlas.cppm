@@ -0,0 +1,283 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+export module xmbshell.render:icon_atlas;
+
+import dreamrender;
+import glm;
+import vulkan_hpp;
+import vma;
+
+namespace render {
+
+/* Packs small images (like thumbnails) into a few large textures ("pages"), so they do not each need their own image,
+ * allocation and descriptor set, and the quad_renderer can draw all icons of a page in one batch.
+ *
+ * Pages are filled with shelves of square cells, all cells of a shelf have the same size (one of cell_sizes).
+ * An icon takes a cell of the smallest size it fits into and gives it back when it is destroyed,
+ * so browsing through one folder after another keeps reusing the same cells instead of allocating new memory.
+ *
+ * add() only queues the pixels, they are copied into the page by record_uploads() at the start of the next frame.
+ * The barrier in front of the copies also waits for earlier frames, which might still sample a cell that is reused.
+ * The atlas has to outlive all of its icons.
+ */
+export class icon_atlas {
+    public:
+        constexpr static unsigned int page_size = 2048;
+        // every icon gets a transparent border inside its cell, so linear filtering never picks up a neighbour
+        constexpr static unsigned int padding = 1;
+        // the cells include the border, so icons of 32, 64, 128 and 256 px fill a cell of their own size class
+        constexpr static std::array<unsigned int, 4> cell_sizes = {32 + 2*padding, 64 + 2*padding, 128 + 2*padding, 256 + 2*padding};
+        constexpr static unsigned int max_icon_size = cell_sizes.back() - 2*padding;
+        // uploads beyond this are left for the next frame, so opening a big folder does not stall a single frame
+        constexpr static vk::DeviceSize max_upload_bytes = 4*1024*1024;
+        constexpr static vk::Format format = vk::Format::eR8G8B8A8Srgb;
+
+        class icon {
+            public:
+                ~icon() {
+                    atlas->release(this);
+                }
+                icon(const icon&) = delete;
+                icon& operator=(const icon&) = delete;
+
+                bool is_loaded() const {
+                    return loaded;
+                }
+                unsigned int get_width() const {
+                    return width;
+                }
+                unsigned int get_height() const {
+                    return height;
+                }
+                vk::ImageView get_view() const {
+                    return atlas->pages.at(page)->imageView.get();
+                }
+                // u, v, width and height of the icon on its page
+                glm::vec4 get_uv() const {
+                    return glm::vec4(position.x + padding, position.y + padding, width, height) / static_cast<float>(page_size);
+                }
+            private:
+                icon(icon_atlas* atlas, unsigned int size_class, unsigned int page, glm::uvec2 position, unsigned int width, unsigned int height)
+                    : atlas(atlas), size_class(size_class), page(page), position(position), width(width), height(height) {}
+
+                icon_atlas* atlas;
+                unsigned int size_class;
+                unsigned int page;
+                glm::uvec2 position; // of the cell
+                unsigned int width, height;
+                bool loaded = false;
+
+                friend class icon_atlas;
+        };
+
+        icon_atlas(vk::Device device, vma::Allocator allocator) : device(device), allocator(allocator) {}
+
+        void prepare(int imageCount) {
+            staging.clear();
+            staging.resize(imageCount);
+        }
+
+        /* Queues "pixels" (RGBA, tightly packed rows) to be copied into a free cell.
+         * Returns nullptr if the image is larger than max_icon_size in either direction.
+         */
+        std::unique_ptr<icon> add(unsigned int width, unsigned int height, std::span<const std::uint8_t> pixels) {
+            if(width == 0 || height == 0 || width > max_icon_size || height > max_icon_size || pixels.size() < std::size_t{width}*height*4) {
+                return nullptr;
+            }
+            unsigned int size_class = 0;
+            while(cell_sizes[size_class] < std::max(width, height) + 2*padding) {
+                size_class++;
+            }
+            auto [page, position] = allocate_cell(size_class);
+            std::unique_ptr<icon> result{new icon(this, size_class, page, position, width, height)};
+
+            // the border is uploaded as well, the cell might still hold the pixels of a bigger icon
+            const unsigned int w = width + 2*padding, h = height + 2*padding;
+            std::vector<std::uint8_t> padded(std::size_t{w}*h*4, 0);
+            for(unsigned int y = 0; y < height; y++) {
+                std::copy_n(pixels.begin() + std::size_t{y}*width*4, width*4, padded.begin() + (std::size_t{y+padding}*w + padding)*4);
+            }
+            uploads.push_back(upload{result.get(), std::move(padded)});
+            return result;
+        }
+
+        bool has_pending_uploads() const {
+            return !uploads.empty();
+        }
+
+        // Records the copies of the queued icons, must be called outside of a render pass before anything is drawn with them.
+        void record_uploads(vk::CommandBuffer cmd, int frame) {
+            if(uploads.empty()) {
+                return;
+            }
+            auto& buffer = staging.at(frame);
+
+            std::size_t count = 0;
+            vk::DeviceSize size = 0;
+            while(count < uploads.size() && (count == 0 || size + uploads[count].pixels.size() <= max_upload_bytes)) {
+                size += uploads[count].pixels.size();
+                count++;
+            }
+            if(buffer.capacity < size) {
+                buffer.capacity = std::max(size, max_upload_bytes);
+                std::tie(buffer.buffer, buffer.allocation) = allocator.createBufferUnique(
+                    vk::BufferCreateInfo({}, buffer.capacity, vk::BufferUsageFlagBits::eTransferSrc),
+                    vma::AllocationCreateInfo({}, vma::MemoryUsage::eCpuToGpu));
+                dreamrender::debugName(device, buffer.buffer.get(), "Icon Atlas Staging Buffer #"+std::to_string(frame));
+            }
+
+            std::vector<bool> touched(pages.size(), false);
+            std::vector<std::vector<vk::BufferImageCopy>> copies(pages.size());
+            vk::DeviceSize offset = 0;
+            for(std::size_t i = 0; i < count; i++) {
+                const auto& u = uploads[i];
+                allocator.copyMemoryToAllocation(u.pixels.data(), buffer.allocation.get(), offset, u.pixels.size());
+                copies[u.target->page].push_back(vk::BufferImageCopy(offset, 0, 0,
+                    vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+                    vk::Offset3D(static_cast<int32_t>(u.target->position.x), static_cast<int32_t>(u.target->position.y), 0),
+                    vk::Extent3D(u.target->width + 2*padding, u.target->height + 2*padding, 1)));
+                touched[u.target->page] = true;
+                u.target->loaded = true;
+                offset += u.pixels.size();
+            }
+            uploads.erase(uploads.begin(), uploads.begin() + static_cast<std::ptrdiff_t>(count));
+
+            std::vector<vk::ImageMemoryBarrier> to_transfer, to_shader;
+            for(std::size_t p = 0; p < pages.size(); p++) {
+                if(!touched[p] && initialized[p]) {
+                    continue;
+                }
+                auto range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+                to_transfer.push_back(vk::ImageMemoryBarrier(
+                    initialized[p] ? vk::AccessFlagBits::eShaderRead : vk::AccessFlags{}, vk::AccessFlagBits::eTransferWrite,
+                    initialized[p] ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                    vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, pages[p]->image, range));
+                to_shader.push_back(vk::ImageMemoryBarrier(
+                    vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                    vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                    vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, pages[p]->image, range));
+            }
+            // also waits for the frames before this one, which might still show an icon whose cell is overwritten now
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+                {}, {}, {}, to_transfer);
+            for(std::size_t p = 0; p < pages.size(); p++) {
+                if(!initialized[p]) {
+                    cmd.clearColorImage(pages[p]->image, vk::ImageLayout::eTransferDstOptimal, vk::ClearColorValue(0.0f, 0.0f, 0.0f, 0.0f),
+                        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+                    initialized[p] = true;
+                }
+                if(!copies[p].empty()) {
+                    cmd.copyBufferToImage(buffer.buffer.get(), pages[p]->image, vk::ImageLayout::eTransferDstOptimal, copies[p]);
+                }
+            }
+            cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                {}, {}, {}, to_shader);
+        }
+
+        std::size_t get_page_count() const {
+            return pages.size();
+        }
+    private:
+        struct shelf {
+            unsigned int size_class;
+            unsigned int page;
+            unsigned int y;
+            unsigned int next_x = 0;
+        };
+        struct cell {
+            unsigned int page;
+            glm::uvec2 position;
+        };
+        struct upload {
+            icon* target;
+            std::vector<std::uint8_t> pixels; // including the border
+        };
+        struct staging_buffer {
+            vma::UniqueBuffer buffer;
+            vma::UniqueAllocation allocation;
+            vk::DeviceSize capacity = 0;
+        };
+
+        cell allocate_cell(unsigned int size_class) {
+            auto& free = free_cells[size_class];
+            if(!free.empty()) {
+                cell c = free.back();
+                free.pop_back();
+                return c;
+            }
+
+            const unsigned int size = cell_sizes[size_class];
+            auto it = std::ranges::find_if(shelves, [&](const shelf& s) {
+                return s.size_class == size_class && s.next_x + size <= page_size;
+            });
+            if(it == shelves.end()) {
+                // a new shelf below the last one of a page, or on a new page
+                unsigned int page = 0;
+                while(page < pages.size() && page_heights[page] + size > page_size) {
+                    page++;
+                }
+                if(page == pages.size()) {
+                    add_page();
+                }
+                it = shelves.insert(shelves.end(), shelf{size_class, page, page_heights[page]});
+                page_heights[page] += size;
+            }
+            cell c{it->page, glm::uvec2(it->next_x, it->y)};
+            it->next_x += size;
+            return c;
+        }
+
+        void add_page() {
+            auto& page = pages.emplace_back(std::make_unique<dreamrender::texture>(device, allocator, vk::Extent2D{page_size, page_size},
+                vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+                format, vk::SampleCountFlagBits::e1, false, vk::ImageAspectFlagBits::eColor));
+            dreamrender::debugName(device, page->image, "Icon Atlas Page #"+std::to_string(pages.size()-1));
+            page_heights.push_back(0);
+            initialized.push_back(false);
+        }
+
+        void release(icon* i) {
+            std::erase_if(uploads, [i](const upload& u) { return u.target == i; });
+            free_cells[i->size_class].push_back(cell{i->page, i->position});
+        }
+
+        vk::Device device;
+        vma::Allocator allocator;
+
+        std::vector<std::unique_ptr<dreamrender::texture>> pages;
+        std::vector<unsigned int> page_heights; // how much of each page is taken by shelves
+        std::vector<bool> initialized;          // whether the page has been cleared yet
+        std::vector<shelf> shelves;
+        std::array<std::vector<cell>, cell_sizes.size()> free_cells;
+
+        std::vector<upload> uploads;
+        std::vector<staging_buffer> staging;
+};
+
+}
@@ -0,0 +1,326 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+export module xmbshell.render:quad_renderer;
+
+import dreamrender;
+import :shaders;
+
+import glm;
+import vulkan_hpp;
+import vma;
+
+namespace render {
+
+/* Draws batches of textured and untextured (rectangle) quads with one instanced draw call per batch,
+ * see shaders/quad.vert and shaders/quad.frag. The quads are collected by a draw_list.
+ *
+ * Instance data is allocated per frame and reused the next time the same frame is rendered, when the GPU is done with it.
+ * Descriptor sets are cached per image view instead, because the same textures are drawn frame after frame.
+ * Vulkan can reuse the handle of a destroyed image view, so owners of drawn textures have to call forget() before destroying them.
+ */
+export class quad_renderer {
+    public:
+        struct instance {
+            glm::vec4 rect; // x, y, width, height in [0, 1] of the framebuffer
+            glm::vec4 uv;   // u, v, width, height of the texture region
+            glm::vec4 color;
+        };
+        struct batch {
+            vk::ImageView texture; // no texture for rectangles
+            vk::Rect2D scissor;
+            std::span<const instance> instances;
+        };
+
+        constexpr static std::size_t chunk_instances = 4096;
+        constexpr static unsigned int sets_per_pool = 256;
+
+        quad_renderer(vk::Device device, vma::Allocator allocator) : device(device), allocator(allocator) {
+            std::scoped_lock lock(instances_mutex);
+            instances.push_back(this);
+        }
+        ~quad_renderer() {
+            std::scoped_lock lock(instances_mutex);
+            std::erase(instances, this);
+        }
+        quad_renderer(const quad_renderer&) = delete;
+        quad_renderer& operator=(const quad_renderer&) = delete;
+
+        // Drops the descriptor sets cached for "view" in all quad_renderers, call it before destroying a texture that was drawn.
+        // Can be called from any thread, the sets are freed once no frame in flight uses them anymore.
+        static void forget(vk::ImageView view) {
+            if(!view) {
+                return;
+            }
+            std::scoped_lock lock(instances_mutex);
+            for(auto* r : instances) {
+                r->forgotten.push_back(view);
+            }
+        }
+
+        void preload(const std::vector<vk::RenderPass>& renderPasses, vk::SampleCountFlagBits sampleCount, vk::PipelineCache pipelineCache = {}) {
+            {
+                vk::SamplerCreateInfo info({}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear,
+                    vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge);
+                sampler = device.createSamplerUnique(info);
+            }
+            {
+                vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment);
+                descriptorSetLayout = device.createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, binding));
+                pipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo({}, descriptorSetLayout.get()));
+            }
+
+            vk::VertexInputBindingDescription input_binding(0, sizeof(instance), vk::VertexInputRate::eInstance);
+            std::array<vk::VertexInputAttributeDescription, 3> input_attributes = {
+                vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(instance, rect)),
+                vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(instance, uv)),
+                vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(instance, color)),
+            };
+            vk::PipelineVertexInputStateCreateInfo vertex_input({}, input_binding, input_attributes);
+            vk::PipelineInputAssemblyStateCreateInfo input_assembly({}, vk::PrimitiveTopology::eTriangleStrip);
+            vk::PipelineTessellationStateCreateInfo tesselation({}, {});
+
+            vk::Viewport v{};
+            vk::Rect2D s{};
+            vk::PipelineViewportStateCreateInfo viewport({}, v, s);
+
+            vk::PipelineRasterizationStateCreateInfo rasterization({}, false, false, vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone, vk::FrontFace::eCounterClockwise, false, 0.0f, 0.0f, 0.0f, 1.0f);
+            vk::PipelineMultisampleStateCreateInfo multisample({}, sampleCount);
+            vk::PipelineDepthStencilStateCreateInfo depthStencil({}, false, false);
+
+            vk::PipelineColorBlendAttachmentState attachment(true, vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd, vk::BlendFactor::eOne, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd);
+            attachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+            vk::PipelineColorBlendStateCreateInfo colorBlend({}, false, vk::LogicOp::eClear, attachment);
+
+            std::array<vk::DynamicState, 2> dynamicStates{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+            vk::PipelineDynamicStateCreateInfo dynamic({}, dynamicStates);
+
+            vk::UniqueShaderModule vertexShader = shaders::quad_renderer::vert(device);
+            vk::UniqueShaderModule fragmentShader = shaders::quad_renderer::frag(device);
+            vk::SpecializationMapEntry entry(0, 0, sizeof(vk::Bool32));
+            for(vk::Bool32 textured : {0u, 1u}) {
+                vk::SpecializationInfo spec_info(1, &entry, sizeof(textured), &textured);
+                std::array<vk::PipelineShaderStageCreateInfo, 2> shaders = {
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertexShader.get(), "main"),
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, fragmentShader.get(), "main", &spec_info)
+                };
+                vk::GraphicsPipelineCreateInfo pipeline_info({}, shaders, &vertex_input,
+                    &input_assembly, &tesselation, &viewport, &rasterization, &multisample, &depthStencil, &colorBlend, &dynamic, pipelineLayout.get(), {});
+                pipelines[textured] = dreamrender::createPipelines(device, pipelineCache, pipeline_info, renderPasses,
+                    textured ? "Quad Renderer Pipeline (textured)" : "Quad Renderer Pipeline (untextured)");
+            }
+        }
+        void prepare(int imageCount) {
+            frames.clear();
+            frames.resize(imageCount);
+        }
+        // Everything "frame" used can be reused once the frame is rendered the next time.
+        void finish(int frame) {
+            frames[frame].finished = true;
+        }
+
+        // Records the batches in order. Consecutive batches with the same pipeline, texture or scissor do not rebind them.
+        void draw(vk::CommandBuffer cmd, int frame, vk::RenderPass renderPass, std::span<const batch> batches) {
+            auto& res = frames[frame];
+            if(res.finished) {
+                res.finished = false;
+                res.used_chunks = 0;
+                res.used_instances = 0;
+                res.reused_at = ++serial;
+                free_retired_sets();
+            }
+            {
+                std::scoped_lock lock(instances_mutex);
+                for(auto view : forgotten) {
+                    if(auto it = descriptor_sets.find(view); it != descriptor_sets.end()) {
+                        retired_sets.push_back(retired_set{it->second, serial});
+                        descriptor_sets.erase(it);
+                    }
+                }
+                forgotten.clear();
+            }
+
+            std::size_t count = 0;
+            for(const auto& b : batches) {
+                count += b.instances.size();
+            }
+            if(count == 0) {
+                return;
+            }
+            auto& chunk = get_chunk(res, count);
+            const std::size_t first = res.used_instances;
+            std::size_t offset = first;
+            for(const auto& b : batches) {
+                allocator.copyMemoryToAllocation(b.instances.data(), chunk.allocation.get(),
+                    offset*sizeof(instance), b.instances.size_bytes());
+                offset += b.instances.size();
+            }
+            res.used_instances = offset;
+
+            cmd.bindVertexBuffers(0, chunk.buffer.get(), {0});
+            std::optional<bool> bound_pipeline;
+            vk::ImageView bound_texture{};
+            std::optional<vk::Rect2D> bound_scissor;
+            offset = first;
+            for(const auto& b : batches) {
+                bool textured = static_cast<bool>(b.texture);
+                if(bound_pipeline != textured) {
+                    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines[textured][renderPass].get());
+                    bound_pipeline = textured;
+                }
+                if(textured && b.texture != bound_texture) {
+                    cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 0, get_descriptor_set(b.texture), {});
+                    bound_texture = b.texture;
+                }
+                if(bound_scissor != b.scissor) {
+                    cmd.setScissor(0, b.scissor);
+                    bound_scissor = b.scissor;
+                }
+                cmd.draw(4, b.instances.size(), 0, offset);
+                offset += b.instances.size();
+            }
+        }
+    private:
+        struct chunk {
+            vma::UniqueBuffer buffer;
+            vma::UniqueAllocation allocation;
+            std::size_t capacity;
+        };
+        struct frame_resources {
+            std::vector<chunk> chunks;
+            std::size_t used_chunks = 0;
+            std::size_t used_instances = 0; // in chunks[used_chunks-1]
+
+            std::uint64_t reused_at = 0; // value of "serial" when the GPU was last known to be done with the frame
+            bool finished = false;
+        };
+        struct pool {
+            vk::UniqueDescriptorPool pool;
+            unsigned int free_sets = sets_per_pool;
+        };
+        struct cached_set {
+            vk::DescriptorSet set;
+            std::size_t pool;
+        };
+        struct retired_set {
+            cached_set set;
+            std::uint64_t retired_at;
+        };
+
+        // Returns a chunk with space for "count" more instances, starting at "res.used_instances".
+        chunk& get_chunk(frame_resources& res, std::size_t count) {
+            if(res.used_chunks > 0 && res.used_instances + count <= res.chunks[res.used_chunks-1].capacity) {
+                return res.chunks[res.used_chunks-1];
+            }
+            res.used_instances = 0;
+            if(res.used_chunks < res.chunks.size() && res.chunks[res.used_chunks].capacity >= count) {
+                return res.chunks[res.used_chunks++];
+            }
+            chunk c{.capacity = std::max(chunk_instances, count)};
+            std::tie(c.buffer, c.allocation) = allocator.createBufferUnique(
+                vk::BufferCreateInfo({}, c.capacity * sizeof(instance), vk::BufferUsageFlagBits::eVertexBuffer),
+                vma::AllocationCreateInfo({}, vma::MemoryUsage::eCpuToGpu));
+            dreamrender::debugName(device, c.buffer.get(), "Quad Renderer Instance Buffer");
+            res.chunks.insert(res.chunks.begin() + res.used_chunks, std::move(c));
+            return res.chunks[res.used_chunks++];
+        }
+
+        vk::DescriptorSet get_descriptor_set(vk::ImageView texture) {
+            if(auto it = descriptor_sets.find(texture); it != descriptor_sets.end()) {
+                return it->second.set;
+            }
+
+            std::array<vk::DescriptorSetLayout, 1> layouts{descriptorSetLayout.get()};
+            std::array<vk::DescriptorSet, 1> sets{};
+            std::size_t index = 0;
+            for(; index < pools.size(); index++) {
+                if(pools[index].free_sets == 0) {
+                    continue;
+                }
+                vk::DescriptorSetAllocateInfo info(pools[index].pool.get(), layouts);
+                if(device.allocateDescriptorSets(&info, sets.data()) == vk::Result::eSuccess) {
+                    break;
+                }
+                pools[index].free_sets = 0; // fragmented, skip it until a set is freed
+            }
+            if(index == pools.size()) {
+                vk::DescriptorPoolSize size(vk::DescriptorType::eCombinedImageSampler, sets_per_pool);
+                auto& p = pools.emplace_back(device.createDescriptorPoolUnique(
+                    vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, sets_per_pool, size)));
+                vk::DescriptorSetAllocateInfo info(p.pool.get(), layouts);
+                if(device.allocateDescriptorSets(&info, sets.data()) != vk::Result::eSuccess) {
+                    throw std::runtime_error("Failed to allocate descriptor set for quad renderer");
+                }
+            }
+            pools[index].free_sets--;
+
+            vk::DescriptorImageInfo image_info(sampler.get(), texture, vk::ImageLayout::eShaderReadOnlyOptimal);
+            device.updateDescriptorSets(vk::WriteDescriptorSet(sets[0], 0, 0, vk::DescriptorType::eCombinedImageSampler, image_info), {});
+            descriptor_sets.emplace(texture, cached_set{sets[0], index});
+            return sets[0];
+        }
+
+        // A retired set can still be bound in a frame that was recorded before it was retired.
+        void free_retired_sets() {
+            std::uint64_t oldest = serial;
+            for(const auto& f : frames) {
+                oldest = std::min(oldest, f.reused_at);
+            }
+            std::erase_if(retired_sets, [&](const retired_set& r) {
+                if(r.retired_at >= oldest) {
+                    return false;
+                }
+                device.freeDescriptorSets(pools[r.set.pool].pool.get(), r.set.set);
+                pools[r.set.pool].free_sets++;
+                return true;
+            });
+        }
+
+        vk::Device device;
+        vma::Allocator allocator;
+
+        vk::UniqueSampler sampler;
+        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+        vk::UniquePipelineLayout pipelineLayout;
+        std::array<dreamrender::UniquePipelineMap, 2> pipelines; // untextured, textured
+
+        std::vector<frame_resources> frames;
+        std::uint64_t serial = 0; // counts how often frames were reused
+
+        std::vector<pool> pools;
+        std::unordered_map<vk::ImageView, cached_set> descriptor_sets;
+        std::vector<retired_set> retired_sets;
+
+        inline static std::mutex instances_mutex;
+        inline static std::vector<quad_renderer*> instances;
+        std::vector<vk::ImageView> forgotten; // guarded by instances_mutex
+};
+
+}
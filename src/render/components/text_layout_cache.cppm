@@ -0,0 +1,153 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+export module xmbshell.render:text_layout_cache;
+
+import dreamrender;
+import glm;
+
+namespace render {
+
+/* Remembers the measured extents of text, keyed by the string and the font size.
+ * Most text on screen (labels, controller buttons, messages) is the same every frame,
+ * so after the first frame it is laid out without asking the font renderer again.
+ *
+ * Only the render thread measures text. invalidate() may be called from any thread
+ * (e.g. from a config callback when the font or the language changes) and takes effect with the next begin_frame().
+ */
+export class text_layout_cache {
+    public:
+        // Entries not used in the current or the previous frame are dropped once there are more than this.
+        constexpr static std::size_t max_entries = 4096;
+
+        struct line {
+            std::size_t offset;
+            std::size_t length;
+            glm::vec2 size;
+        };
+        // The lines of a text split at '\n', "size" is the width of the widest and the height of all lines.
+        struct layout {
+            glm::vec2 size;
+            std::vector<line> lines;
+        };
+
+        void begin_frame() {
+            frame++;
+            if(auto g = generation.load(std::memory_order_relaxed); g != current_generation) {
+                current_generation = g;
+                extents.clear();
+                layouts.clear();
+                return;
+            }
+            evict(extents);
+            evict(layouts);
+        }
+
+        void invalidate() {
+            generation.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        glm::vec2 measure(dreamrender::gui_renderer& renderer, std::string_view text, float size) {
+            auto it = extents.find(key_view{text, size});
+            if(it == extents.end()) {
+                it = extents.emplace(key{std::string(text), size}, entry<glm::vec2>{renderer.measure_text(text, size)}).first;
+            }
+            it->second.last_used = frame;
+            return it->second.value;
+        }
+
+        // The returned layout stays valid until the next begin_frame().
+        const layout& lay_out(dreamrender::gui_renderer& renderer, std::string_view text, float size) {
+            auto it = layouts.find(key_view{text, size});
+            if(it == layouts.end()) {
+                layout l{glm::vec2(0.0f), {}};
+                for(const auto part : std::views::split(text, '\n')) {
+                    std::string_view sv(part);
+                    glm::vec2 s = measure(renderer, sv, size);
+                    l.lines.push_back(line{static_cast<std::size_t>(sv.data() - text.data()), sv.size(), s});
+                    l.size.x = std::max(l.size.x, s.x);
+                    l.size.y += s.y;
+                }
+                it = layouts.emplace(key{std::string(text), size}, entry<layout>{std::move(l)}).first;
+            }
+            it->second.last_used = frame;
+            return it->second.value;
+        }
+    private:
+        struct key {
+            std::string text;
+            float size;
+        };
+        struct key_view {
+            std::string_view text;
+            float size;
+        };
+        struct key_hash {
+            using is_transparent = void;
+            std::size_t operator()(const key_view& k) const {
+                std::size_t h = std::hash<std::string_view>{}(k.text);
+                return h ^ (std::hash<float>{}(k.size) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+            }
+            std::size_t operator()(const key& k) const {
+                return (*this)(key_view{k.text, k.size});
+            }
+        };
+        struct key_equal {
+            using is_transparent = void;
+            static key_view view(const key& k) { return key_view{k.text, k.size}; }
+            static key_view view(const key_view& k) { return k; }
+            bool operator()(const auto& a, const auto& b) const {
+                return view(a).size == view(b).size && view(a).text == view(b).text;
+            }
+        };
+        template<typename T>
+        struct entry {
+            T value;
+            std::uint64_t last_used = 0;
+        };
+        template<typename T>
+        using map = std::unordered_map<key, entry<T>, key_hash, key_equal>;
+
+        template<typename T>
+        void evict(map<T>& m) {
+            if(m.size() <= max_entries) {
+                return;
+            }
+            std::erase_if(m, [this](const auto& e) { return e.second.last_used + 1 < frame; });
+        }
+
+        map<glm::vec2> extents;
+        map<layout> layouts;
+        std::uint64_t frame = 0;
+        std::atomic<unsigned int> generation = 0;
+        unsigned int current_generation = 0;
+};
+
+}
@@ -0,0 +1,191 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+export module xmbshell.render:upscale_pass;
+
+import dreamrender;
+import :shaders;
+
+import glm;
+import vulkan_hpp;
+import vma;
+
+namespace render {
+
+/* Lets the shell render at a lower resolution than the swapchain: everything is rendered into one of the
+ * intermediate images of this pass (one per frame in flight), which record() then scales up into the swapchain image
+ * with bilinear filtering and a contrast adaptive sharpening filter (see shaders/upscale.frag).
+ *
+ * The intermediate images have to be in ShaderReadOnlyOptimal by the time record() is called,
+ * which the render pass rendering into them should take care of.
+ */
+export class upscale_pass {
+    public:
+        upscale_pass(vk::Device device, vma::Allocator allocator) : device(device), allocator(allocator) {}
+
+        // "finalLayout" is the layout the swapchain images should be left in.
+        void preload(vk::Format format, vk::ImageLayout finalLayout, vk::PipelineCache pipelineCache = {}) {
+            this->format = format;
+            {
+                vk::AttachmentDescription attachment({}, format, vk::SampleCountFlagBits::e1,
+                    vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eStore,
+                    vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare,
+                    vk::ImageLayout::eUndefined, finalLayout);
+                vk::AttachmentReference ref(0, vk::ImageLayout::eColorAttachmentOptimal);
+                vk::SubpassDescription subpass({}, vk::PipelineBindPoint::eGraphics, {}, ref);
+                vk::SubpassDependency dep(vk::SubpassExternal, 0,
+                    vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                    {}, vk::AccessFlagBits::eColorAttachmentWrite);
+                renderPass = device.createRenderPassUnique(vk::RenderPassCreateInfo({}, attachment, subpass, dep));
+                dreamrender::debugName(device, renderPass.get(), "Upscale Render Pass");
+            }
+            {
+                vk::SamplerCreateInfo info({}, vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest,
+                    vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge);
+                sampler = device.createSamplerUnique(info);
+            }
+            {
+                vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment);
+                descriptorSetLayout = device.createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, binding));
+                vk::PushConstantRange range(vk::ShaderStageFlagBits::eFragment, 0, sizeof(push_constants));
+                pipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo({}, descriptorSetLayout.get(), range));
+            }
+            {
+                vk::PipelineVertexInputStateCreateInfo vertex_input({}, {}, {});
+                vk::PipelineInputAssemblyStateCreateInfo input_assembly({}, vk::PrimitiveTopology::eTriangleList);
+                vk::PipelineTessellationStateCreateInfo tesselation({}, {});
+
+                vk::Viewport v{};
+                vk::Rect2D s{};
+                vk::PipelineViewportStateCreateInfo viewport({}, v, s);
+
+                vk::PipelineRasterizationStateCreateInfo rasterization({}, false, false, vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone, vk::FrontFace::eCounterClockwise, false, 0.0f, 0.0f, 0.0f, 1.0f);
+                vk::PipelineMultisampleStateCreateInfo multisample({}, vk::SampleCountFlagBits::e1);
+                vk::PipelineDepthStencilStateCreateInfo depthStencil({}, false, false);
+
+                vk::PipelineColorBlendAttachmentState attachment(false);
+                attachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+                vk::PipelineColorBlendStateCreateInfo colorBlend({}, false, vk::LogicOp::eClear, attachment);
+
+                std::array<vk::DynamicState, 2> dynamicStates{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+                vk::PipelineDynamicStateCreateInfo dynamic({}, dynamicStates);
+
+                vk::UniqueShaderModule vertexShader = shaders::upscale_pass::vert(device);
+                vk::UniqueShaderModule fragmentShader = shaders::upscale_pass::frag(device);
+                std::array<vk::PipelineShaderStageCreateInfo, 2> shaders = {
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertexShader.get(), "main"),
+                    vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, fragmentShader.get(), "main")
+                };
+                vk::GraphicsPipelineCreateInfo pipeline_info({}, shaders, &vertex_input,
+                    &input_assembly, &tesselation, &viewport, &rasterization, &multisample, &depthStencil, &colorBlend, &dynamic, pipelineLayout.get(), {});
+                pipelines = dreamrender::createPipelines(device, pipelineCache, pipeline_info, {renderPass.get()}, "Upscale Pipeline");
+            }
+        }
+
+        // Creates the framebuffers for the swapchain images, resize() has to be called before the next record().
+        void prepare(const std::vector<vk::ImageView>& swapchainViews, vk::Extent2D swapchainExtent) {
+            outputExtent = swapchainExtent;
+            targets.clear();
+            descriptorPool.reset();
+            framebuffers.clear();
+            for(unsigned int i = 0; i < swapchainViews.size(); i++) {
+                vk::FramebufferCreateInfo info({}, renderPass.get(), swapchainViews[i], swapchainExtent.width, swapchainExtent.height, 1);
+                framebuffers.push_back(device.createFramebufferUnique(info));
+                dreamrender::debugName(device, framebuffers.back().get(), "Upscale Framebuffer #"+std::to_string(i));
+            }
+        }
+        /* (Re)creates the intermediate images with "extent".
+         * The previous ones are destroyed immediately, so no frame in flight may still use them.
+         */
+        void resize(vk::Extent2D extent) {
+            inputExtent = extent;
+            targets.clear();
+            descriptorPool.reset();
+            const auto count = static_cast<uint32_t>(framebuffers.size());
+            vk::DescriptorPoolSize size(vk::DescriptorType::eCombinedImageSampler, count);
+            descriptorPool = device.createDescriptorPoolUnique(vk::DescriptorPoolCreateInfo({}, count, size));
+            std::vector<vk::DescriptorSetLayout> layouts(count, descriptorSetLayout.get());
+            descriptorSets = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(descriptorPool.get(), layouts));
+            for(unsigned int i = 0; i < count; i++) {
+                auto& target = targets.emplace_back(std::make_unique<dreamrender::texture>(device, allocator, extent,
+                    vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc,
+                    format, vk::SampleCountFlagBits::e1, false, vk::ImageAspectFlagBits::eColor));
+                dreamrender::debugName(device, target->image, "Upscale Source #"+std::to_string(i));
+                vk::DescriptorImageInfo image_info(sampler.get(), target->imageView.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
+                device.updateDescriptorSets(vk::WriteDescriptorSet(descriptorSets[i], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &image_info), {});
+            }
+        }
+
+        vk::Extent2D get_extent() const {
+            return inputExtent;
+        }
+        vk::Image get_image(int frame) const {
+            return targets.at(frame)->image;
+        }
+        vk::ImageView get_image_view(int frame) const {
+            return targets.at(frame)->imageView.get();
+        }
+
+        // Scales the intermediate image of "frame" up into its swapchain image.
+        void record(vk::CommandBuffer cmd, int frame, float sharpness) {
+            cmd.beginRenderPass(vk::RenderPassBeginInfo(renderPass.get(), framebuffers.at(frame).get(),
+                vk::Rect2D({0, 0}, outputExtent)), vk::SubpassContents::eInline);
+            cmd.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(outputExtent.width), static_cast<float>(outputExtent.height), 0.0f, 1.0f));
+            cmd.setScissor(0, vk::Rect2D({0, 0}, outputExtent));
+
+            cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines[renderPass.get()].get());
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 0, descriptorSets.at(frame), {});
+            push_constants constants{
+                .texel = glm::vec2(1.0f / static_cast<float>(inputExtent.width), 1.0f / static_cast<float>(inputExtent.height)),
+                .sharpness = sharpness,
+            };
+            cmd.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eFragment, 0, sizeof(push_constants), &constants);
+            cmd.draw(3, 1, 0, 0);
+            cmd.endRenderPass();
+        }
+    private:
+        struct push_constants {
+            glm::vec2 texel;
+            float sharpness;
+        };
+
+        vk::Device device;
+        vma::Allocator allocator;
+        vk::Format format{};
+
+        vk::UniqueRenderPass renderPass;
+        vk::UniqueSampler sampler;
+        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+        vk::UniquePipelineLayout pipelineLayout;
+        dreamrender::UniquePipelineMap pipelines;
+
+        vk::Extent2D outputExtent;
+        vk::Extent2D inputExtent;
+        std::vector<vk::UniqueFramebuffer> framebuffers;
+        vk::UniqueDescriptorPool descriptorPool;
+        std::vector<vk::DescriptorSet> descriptorSets;
+        std::vector<std::unique_ptr<dreamrender::texture>> targets;
+};
+
+}
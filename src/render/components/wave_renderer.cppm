@@ -16,6 +16,8 @@
  */
 module;
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstdint>
 #include <vector>
@@ -70,14 +72,17 @@ void generate_grid(int N, std::vector<glm::vec3> &vertices, std::vector<uint16_t
     }
 }
 
-const static auto startTime = std::chrono::high_resolution_clock::now();
-
 export class wave_renderer {
     public:
-        static constexpr int grid_quality = 128;
+        // Grid sizes that can be chosen with set_grid_quality, from the finest to the coarsest.
+        static constexpr std::array grid_qualities = {128, 64, 32};
         glm::vec3 waveColor = {0.5, 0.5, 0.5};
         float speed = 1.0;
 
+        [[nodiscard]] bool is_animated() const {
+            return speed != 0.0f;
+        }
+
         wave_renderer(vk::Device device, vma::Allocator allocator, vk::Extent2D frameSize) : device(device), allocator(allocator), frameSize(frameSize),
             aspectRatio(static_cast<double>(frameSize.width)/frameSize.height) {}
         ~wave_renderer() = default;
@@ -85,14 +90,19 @@ export class wave_renderer {
         void preload(const std::vector<vk::RenderPass>& renderPasses, vk::SampleCountFlagBits sampleCount, vk::PipelineCache pipelineCache = {})
         {
             {
+                // all grids share one vertex and one index buffer
                 std::vector<glm::vec3> vertices;
                 std::vector<uint16_t> indices;
-                generate_grid(grid_quality, vertices, indices);
+                for(unsigned int i = 0; i < grid_qualities.size(); i++) {
+                    grids[i].vertexOffset = static_cast<int32_t>(vertices.size());
+                    grids[i].firstIndex = static_cast<uint32_t>(indices.size());
+                    generate_grid(grid_qualities[i], vertices, indices);
+                    grids[i].indexCount = static_cast<uint32_t>(indices.size()) - grids[i].firstIndex;
+                    spdlog::debug("Grid {}x{} made of {} indices", grid_qualities[i], grid_qualities[i], grids[i].indexCount);
+                }
                 vertexCount = vertices.size();
                 indexCount = indices.size();
 
-                spdlog::debug("Grid made of {} vertices and {} indices", vertexCount, indexCount);
-
                 {
                     std::tie(vertexBuffer, vertexAllocation) = allocator.createBufferUnique(
                         vk::BufferCreateInfo({}, vertices.size() * sizeof(vertices[0]), vk::BufferUsageFlagBits::eVertexBuffer),
@@ -153,8 +163,16 @@ export class wave_renderer {
         void prepare(int imageCount) {}
         void finish(int frame) {}
 
-        void render(vk::CommandBuffer cmd, int frame, vk::RenderPass renderPass) {
-            auto time = std::chrono::high_resolution_clock::now() - startTime;
+        // 0 is the finest grid in grid_qualities, higher values are coarser and cheaper to render.
+        void set_grid_quality(unsigned int quality) {
+            grid = std::min<unsigned int>(quality, grid_qualities.size()-1);
+        }
+        unsigned int get_grid_quality() const {
+            return grid;
+        }
+
+        // "time" is the time since the wave started moving
+        void render(vk::CommandBuffer cmd, int frame, vk::RenderPass renderPass, std::chrono::duration<double> time) {
             auto seconds = std::chrono::duration_cast<std::chrono::seconds>(time);
             auto partialSeconds = std::chrono::duration<float>(time-seconds);
 
@@ -168,7 +186,8 @@ export class wave_renderer {
 
             cmd.bindVertexBuffers(0, vertexBuffer.get(), {0});
             cmd.bindIndexBuffer(indexBuffer.get(), 0, vk::IndexType::eUint16);
-            cmd.drawIndexed(indexCount, 1, 0, 0, 0);
+            const auto& g = grids[grid];
+            cmd.drawIndexed(g.indexCount, 1, g.firstIndex, g.vertexOffset, 0);
         }
     private:
         vk::Device device;
@@ -185,6 +204,14 @@ export class wave_renderer {
         vma::UniqueBuffer indexBuffer;
         vma::UniqueAllocation indexAllocation;
 
+        struct grid_range {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            int32_t vertexOffset;
+        };
+        std::array<grid_range, grid_qualities.size()> grids{};
+        unsigned int grid = 0;
+
         vk::UniquePipelineLayout pipelineLayout;
         dreamrender::UniquePipelineMap pipelines;
 };
@@ -0,0 +1,77 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <array>
+#include <stdexcept>
+
+export module xmbshell.render:yuv420p_pipeline;
+
+import dreamrender;
+import :shaders;
+
+import vulkan_hpp;
+
+namespace render {
+
+/* The compute pipeline converting the planes of a YUV420P video frame to RGBA (shaders/yuv420p/decode.comp).
+ * It does not depend on the video, so one instance can be created ahead of time and shared by all video players.
+ * Descriptor set layout: binding 0 = output (rgba8 unorm), bindings 1-3 = Y, Cb and Cr planes (r8 unorm),
+ * all storage images in general layout.
+ */
+export class yuv420p_pipeline {
+    public:
+        yuv420p_pipeline(vk::Device device) : device(device) {}
+
+        // Can be called from any thread, the pipeline cache is synchronized by the driver.
+        void preload(vk::PipelineCache pipelineCache = {}) {
+            std::array<vk::DescriptorSetLayoutBinding, 4> bindings = {
+                vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+                vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+                vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute),
+                vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute)
+            };
+            descriptorSetLayout = device.createDescriptorSetLayoutUnique(vk::DescriptorSetLayoutCreateInfo({}, bindings));
+            pipelineLayout = device.createPipelineLayoutUnique(vk::PipelineLayoutCreateInfo({}, descriptorSetLayout.get()));
+
+            vk::UniqueShaderModule shaderModule = shaders::yuv420p::decode_comp(device);
+            vk::PipelineShaderStageCreateInfo shaderInfo({}, vk::ShaderStageFlagBits::eCompute, shaderModule.get(), "main");
+            auto [r, p] = device.createComputePipelineUnique(pipelineCache, vk::ComputePipelineCreateInfo({}, shaderInfo, pipelineLayout.get())).asTuple();
+            if(r != vk::Result::eSuccess) {
+                throw std::runtime_error("Failed to create compute pipeline");
+            }
+            pipeline = std::move(p);
+            dreamrender::debugName(device, pipeline.get(), "YUV420P Decode Pipeline");
+        }
+
+        vk::DescriptorSetLayout get_descriptor_set_layout() const {
+            return descriptorSetLayout.get();
+        }
+        vk::PipelineLayout get_pipeline_layout() const {
+            return pipelineLayout.get();
+        }
+        vk::Pipeline get_pipeline() const {
+            return pipeline.get();
+        }
+    private:
+        vk::Device device;
+        vk::UniqueDescriptorSetLayout descriptorSetLayout;
+        vk::UniquePipelineLayout pipelineLayout;
+        vk::UniquePipeline pipeline;
+};
+
+}
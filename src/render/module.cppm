@@ -18,5 +18,14 @@ module;
 
 export module xmbshell.render;
 
+export import :background_layer;
+export import :blur_pass;
+export import :draw_list;
+export import :gpu_timer;
+export import :icon_atlas;
+export import :quad_renderer;
+export import :text_layout_cache;
+export import :upscale_pass;
 export import :wave_renderer;
+export import :yuv420p_pipeline;
 export import :shaders;
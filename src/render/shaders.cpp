@@ -26,11 +26,11 @@ import vulkan_hpp;
 
 namespace render::shaders {
 
-namespace blur {
+namespace dual_filter {
     #pragma clang diagnostic push
     #pragma clang diagnostic ignored "-Wc23-extensions"
     constexpr char comp_array[] = {
-    #embed "shaders/blur.comp.spv"
+    #embed "shaders/dual_filter.comp.spv"
     };
     #pragma clang diagnostic pop
 
@@ -41,6 +41,50 @@ namespace blur {
     }
 }
 
+namespace quad_renderer {
+    #pragma clang diagnostic push
+    #pragma clang diagnostic ignored "-Wc23-extensions"
+    constexpr char vert_array[] = {
+    #embed "shaders/quad.vert.spv"
+    };
+    constexpr char frag_array[] = {
+    #embed "shaders/quad.frag.spv"
+    };
+    #pragma clang diagnostic pop
+
+    constexpr std::array vert_shader = dreamrender::convert<std::to_array(vert_array), uint32_t>();
+    constexpr std::array frag_shader = dreamrender::convert<std::to_array(frag_array), uint32_t>();
+
+    vk::UniqueShaderModule vert(vk::Device device) {
+        return dreamrender::createShader(device, vert_shader);
+    }
+    vk::UniqueShaderModule frag(vk::Device device) {
+        return dreamrender::createShader(device, frag_shader);
+    }
+}
+
+namespace upscale_pass {
+    #pragma clang diagnostic push
+    #pragma clang diagnostic ignored "-Wc23-extensions"
+    constexpr char vert_array[] = {
+    #embed "shaders/upscale.vert.spv"
+    };
+    constexpr char frag_array[] = {
+    #embed "shaders/upscale.frag.spv"
+    };
+    #pragma clang diagnostic pop
+
+    constexpr std::array vert_shader = dreamrender::convert<std::to_array(vert_array), uint32_t>();
+    constexpr std::array frag_shader = dreamrender::convert<std::to_array(frag_array), uint32_t>();
+
+    vk::UniqueShaderModule vert(vk::Device device) {
+        return dreamrender::createShader(device, vert_shader);
+    }
+    vk::UniqueShaderModule frag(vk::Device device) {
+        return dreamrender::createShader(device, frag_shader);
+    }
+}
+
 namespace wave_renderer {
     #pragma clang diagnostic push
     #pragma clang diagnostic ignored "-Wc23-extensions"
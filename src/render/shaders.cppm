@@ -22,10 +22,20 @@ import vulkan_hpp;
 
 export namespace render::shaders {
 
-namespace blur {
+namespace dual_filter {
     vk::UniqueShaderModule comp(vk::Device device);
 }
 
+namespace quad_renderer {
+    vk::UniqueShaderModule vert(vk::Device device);
+    vk::UniqueShaderModule frag(vk::Device device);
+}
+
+namespace upscale_pass {
+    vk::UniqueShaderModule vert(vk::Device device);
+    vk::UniqueShaderModule frag(vk::Device device);
+}
+
 namespace wave_renderer {
     vk::UniqueShaderModule vert(vk::Device device);
     vk::UniqueShaderModule frag(vk::Device device);
@@ -0,0 +1,205 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+
+module xmbshell.trace;
+
+import spdlog;
+import xmbshell.utils;
+
+namespace trace
+{
+    namespace {
+        constexpr std::size_t buffer_size = 16384; // events kept per thread, a few seconds of the render thread
+        constexpr std::size_t detail_size = 32;
+        constexpr std::size_t max_exited_threads = 8;
+
+        struct event {
+            const char* name;
+            const std::type_info* type;
+            std::array<char, detail_size> detail;
+            clock::time_point begin;
+            clock::time_point end;
+        };
+
+        /* Only the owning thread writes into "events", it publishes an event by incrementing "written" afterwards.
+         * dump() copies the events without stopping the owner and throws away the ones that might have been overwritten meanwhile.
+         */
+        struct thread_buffer {
+            unsigned int id = 0;
+            std::string name; // guarded by registry_mutex
+            std::atomic<bool> exited = false;
+            std::atomic<std::uint64_t> written = 0;
+            std::array<event, buffer_size> events;
+        };
+
+        const clock::time_point origin = clock::now();
+
+        std::mutex registry_mutex;
+        std::vector<std::shared_ptr<thread_buffer>> registry;
+        unsigned int next_id = 1;
+
+        std::shared_ptr<thread_buffer> create_buffer() {
+            auto buffer = std::make_shared<thread_buffer>();
+
+            std::lock_guard lock(registry_mutex);
+            // every std::async job runs on a new thread, so only the last few threads that exited are kept
+            auto exited = std::ranges::count_if(registry, [](const auto& b){ return b->exited.load(); });
+            for(auto it = registry.begin(); it != registry.end() && exited > max_exited_threads;) {
+                if((*it)->exited) {
+                    it = registry.erase(it);
+                    exited--;
+                } else {
+                    ++it;
+                }
+            }
+            buffer->id = next_id++;
+            buffer->name = std::format("thread {}", buffer->id);
+            registry.push_back(buffer);
+            return buffer;
+        }
+
+        struct thread_handle {
+            std::shared_ptr<thread_buffer> buffer = create_buffer();
+            ~thread_handle() {
+                buffer->exited = true;
+            }
+        };
+        thread_buffer& current_buffer() {
+            thread_local thread_handle handle;
+            return *handle.buffer;
+        }
+
+        std::string quote(std::string_view str) {
+            std::string result = "\"";
+            for(char c : str) {
+                if(c == '"' || c == '\\') {
+                    result += '\\';
+                    result += c;
+                } else if(static_cast<unsigned char>(c) < 0x20) {
+                    result += std::format("\\u{:04x}", static_cast<unsigned int>(c));
+                } else {
+                    result += c;
+                }
+            }
+            return result + "\"";
+        }
+
+        double microseconds(clock::duration d) {
+            return std::chrono::duration<double, std::micro>(d).count();
+        }
+    }
+
+    void set_thread_name(std::string_view name) {
+        auto& buffer = current_buffer();
+        std::lock_guard lock(registry_mutex);
+        buffer.name = name;
+    }
+
+    void record(const char* name, const std::type_info* type, std::string_view detail, clock::time_point begin, clock::time_point end) {
+        auto& buffer = current_buffer();
+        auto index = buffer.written.load(std::memory_order_relaxed);
+        auto& e = buffer.events[index % buffer_size];
+        e.name = name;
+        e.type = type;
+        auto length = std::min(detail.size(), detail_size - 1);
+        std::copy_n(detail.data(), length, e.detail.begin());
+        e.detail[length] = '\0';
+        e.begin = begin;
+        e.end = end;
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+    void dump(const std::filesystem::path& path) {
+        struct thread_info {
+            std::shared_ptr<thread_buffer> buffer;
+            std::string name;
+        };
+        std::vector<thread_info> threads;
+        {
+            std::lock_guard lock(registry_mutex);
+            for(const auto& b : registry) {
+                threads.push_back({b, b->name});
+            }
+        }
+
+        std::ofstream out(path);
+        if(!out) {
+            throw std::runtime_error("Cannot open "+path.string()+" to write the trace to");
+        }
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool first = true;
+        auto write = [&](const std::string& json) {
+            out << (first ? "  " : ",\n  ") << json;
+            first = false;
+        };
+
+        std::size_t count = 0;
+        std::vector<event> events;
+        for(const auto& [buffer, name] : threads) {
+            write(std::format(R"({{"name": "thread_name", "ph": "M", "pid": 1, "tid": {}, "args": {{"name": {}}}}})", buffer->id, quote(name)));
+
+            auto end = buffer->written.load(std::memory_order_acquire);
+            auto begin = end > buffer_size ? end - buffer_size : 0;
+            events.clear();
+            for(auto i = begin; i < end; i++) {
+                events.push_back(buffer->events[i % buffer_size]);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // the owner might have been writing the next event (and the ones after it) while we were copying
+            auto written = buffer->written.load(std::memory_order_relaxed) + 1;
+            auto valid = written > buffer_size ? written - buffer_size : 0;
+
+            for(auto i = std::max(begin, valid); i < end; i++) {
+                const auto& e = events[i - begin];
+                std::string event_name = e.name;
+                if(e.type) {
+                    event_name += " " + utils::demangle(e.type->name());
+                }
+                std::string args = e.detail[0] ? std::format(R"(, "args": {{"detail": {}}})", quote(e.detail.data())) : std::string{};
+                write(std::format(R"({{"name": {}, "ph": "X", "pid": 1, "tid": {}, "ts": {:.3f}, "dur": {:.3f}{}}})",
+                    quote(event_name), buffer->id, microseconds(e.begin - origin), microseconds(e.end - e.begin), args));
+                count++;
+            }
+        }
+        out << "\n]}\n";
+        spdlog::info("Wrote {} trace events of {} threads to {}", count, threads.size(), path.string());
+    }
+
+    std::filesystem::path dump() {
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        auto path = std::filesystem::temp_directory_path() / std::format("xmbshell-trace-{}.json", seconds);
+        dump(path);
+        return path;
+    }
+}
@@ -0,0 +1,65 @@
+/* XMBShell, a console-like desktop shell
+ * Copyright (C) 2025 - JCM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+module;
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+#include <typeinfo>
+
+export module xmbshell.trace;
+
+/* Records spans of work from every thread of the shell, so they can be looked at together in a trace viewer
+ * (chrome://tracing or https://ui.perfetto.dev), e.g. to see the render thread waiting while the Glib thread runs a config callback.
+ * Each thread writes into its own ring buffer without taking a lock, only the most recent events are kept.
+ */
+export namespace trace
+{
+    using clock = std::chrono::steady_clock;
+
+    // Names the calling thread in the trace, threads that never call this show up as "thread <n>".
+    void set_thread_name(std::string_view name);
+
+    /* Records a finished span on the calling thread.
+     * "name" is not copied and must stay valid until the process exits (use a string literal),
+     * "type" is appended to the name (for spans of a component), "detail" is copied into the event (and truncated).
+     */
+    void record(const char* name, const std::type_info* type, std::string_view detail, clock::time_point begin, clock::time_point end);
+
+    // Writes all events that are still in the ring buffers as Chrome trace JSON.
+    void dump(const std::filesystem::path& path);
+    // Same as above, but into a new file in the temporary directory, returns its path.
+    std::filesystem::path dump();
+
+    // Records everything until it is destroyed as one span, "detail" has to stay valid until then.
+    class scope {
+        public:
+            explicit scope(const char* name, std::string_view detail = {}) : name(name), detail(detail), begin(clock::now()) {}
+            scope(const char* name, const std::type_info& type) : name(name), type(&type), begin(clock::now()) {}
+            ~scope() {
+                record(name, type, detail, begin, clock::now());
+            }
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+        private:
+            const char* name;
+            const std::type_info* type = nullptr;
+            std::string_view detail;
+            clock::time_point begin;
+    };
+}
@@ -16,6 +16,8 @@
  */
 module;
 
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <filesystem>
 #include <iomanip>
@@ -271,6 +273,35 @@ namespace utils
         oss << std::fixed << std::setprecision(n) << d;
         return oss.str();
     }
+
+    namespace {
+        std::atomic<bool> fixed_step_enabled = false;
+        std::atomic<std::chrono::system_clock::rep> fixed_step_now{};
+        std::chrono::system_clock::duration fixed_step{};
+    }
+
+    time_point clock::now() {
+        if(fixed_step_enabled.load(std::memory_order_acquire)) {
+            return time_point(std::chrono::system_clock::duration(fixed_step_now.load(std::memory_order_relaxed)));
+        }
+        return std::chrono::system_clock::now();
+    }
+
+    void clock::use_fixed_step(std::chrono::duration<double> step) {
+        fixed_step = std::chrono::duration_cast<std::chrono::system_clock::duration>(step);
+        fixed_step_now.store(std::chrono::system_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        fixed_step_enabled.store(true, std::memory_order_release);
+    }
+
+    bool clock::is_fixed_step() {
+        return fixed_step_enabled.load(std::memory_order_acquire);
+    }
+
+    void clock::advance() {
+        if(is_fixed_step()) {
+            fixed_step_now.fetch_add(fixed_step.count(), std::memory_order_relaxed);
+        }
+    }
 }
 
 #ifdef __GNUG__
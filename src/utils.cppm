@@ -217,6 +217,21 @@ export namespace utils
     }
 
     using time_point = std::chrono::time_point<std::chrono::system_clock>;
+
+    /* Time source for everything that is animated in the shell.
+     * It follows the system clock, unless it was switched to a fixed step per frame (for headless rendering),
+     * in which case it only moves forward when advance() is called once per rendered frame.
+     */
+    class clock {
+        public:
+            static time_point now();
+
+            // Freezes the clock at the current time and moves it forward by "step" on every advance() from now on.
+            static void use_fixed_step(std::chrono::duration<double> step);
+            static bool is_fixed_step();
+            static void advance();
+    };
+
     constexpr double progress(time_point now, time_point start, std::chrono::duration<double> duration) {
         double d = std::chrono::duration<double>(now - start).count() / duration.count();
         return std::clamp(d, 0.0, 1.0);
@@ -1,69 +1,45 @@
 #!/bin/bash
 
-format_spec="05d"
-
-export DREAMRENDER_HEADLESS=1
-export DREAMRENDER_HEADLESS_WIDTH=960
-export DREAMRENDER_HEADLESS_HEIGHT=540
-export DREAMRENDER_HEADLESS_OUTPUT_DIR="output/"
-export DREAMRENDER_HEADLESS_OUTPUT_PATTERN="{:$format_spec}.bmp"
+width=960
+height=540
 
 export GSETTINGS_SCHEMA_DIR="$PWD/schemas:$GSETTINGS_SCHEMA_DIR"
 export XMB_ASSET_DIR=.
 export SPDLOG_LEVEL=debug
 
-key_up() {
-    echo "keyboard down 82 1073741906 0\nkeyboard up 82 1073741906 0"
-}
-key_down() {
-    echo "keyboard down 81 1073741905 0\nkeyboard up 81 1073741905 0"
-}
-key_left() {
-    echo "keyboard down 80 1073741904 0\nkeyboard up 80 1073741904 0"
-}
-key_right() {
-    echo "keyboard down 79 1073741903 0\nkeyboard up 79 1073741903 0"
-}
-key_return() {
-    echo "keyboard down 40 13 0\nkeyboard up 40 13 0"
-}
-key_escape() {
-    echo "keyboard down 41 27 0\nkeyboard up 41 27 0"
-}
-
+# Every key is scripted to a frame number and the shell runs with a fixed step per frame,
+# so the output is the same on every run, no matter how fast the frames are rendered.
+framerate=30
 duration=15
-( \
-    sleep 1.0; key_down; \
-    sleep 0.5; key_up; \
-    sleep 0.5; key_right; \
-    sleep 0.5; key_down; \
-    sleep 0.5; key_return; \
-    sleep 0.5; key_down; \
-    sleep 0.5; key_return; \
-    sleep 0.5; key_down; \
-    sleep 0.5; key_up; \
-    sleep 0.5; key_escape; \
-    sleep 0.5; key_escape; \
-    sleep 0.5; key_down; \
-    sleep 0.5; key_return; \
-    sleep 0.5; key_return; \
-    sleep 0.5; key_escape; \
-    sleep 0.5; key_escape; \
-    sleep 0.5; key_left; \
-    sleep 0.5; key_down; \
-    sleep 0.5; key_return; \
-    sleep 0.5; key_right; \
-    sleep 0.5; key_return; \
-) | dbus-launch timeout $duration ./build/xmbshell | tee build/test-log.txt
-
-frames=$(ls -1q $DREAMRENDER_HEADLESS_OUTPUT_DIR | wc -l)
-framerate=$(($frames / $duration))
+script=$(mktemp)
+trap 'rm -f "$script"' EXIT
+frame=30
+for key in down up right down return down return down up escape escape down return return escape escape left down return right return; do
+    echo "$frame key $key" >> "$script"
+    frame=$((frame + framerate / 2))
+done
+echo "$((duration * framerate)) quit" >> "$script"
+
+# The frames are encoded while rendering, so no images are written to disk.
+# Rendering can be slower than real time (e.g. on a software renderer), so the limit only catches a shell
+# that does not quit at the end of the script.
+time_limit=$((duration * 10))
+dbus-launch timeout --kill-after=10 $time_limit ./build/xmbshell --width $width --height $height --fixed-fps $framerate --input-script "$script" \
+    --headless-encode build/test-output.webm | tee build/test-log.txt
+
+# The same run at half the resolution, scaled up to the screen. Clipped text (news ticker, text viewer) and everything else
+# has to end up where it is at full resolution, so both videos have to look alike.
+dbus-launch timeout --kill-after=10 $time_limit ./build/xmbshell --width $width --height $height --fixed-fps $framerate --input-script "$script" \
+    --render-scale 0.5 --headless-encode build/test-output-half.webm | tee build/test-log-half.txt
+ssim=$(ffmpeg -threads 1 -i build/test-output.webm -i build/test-output-half.webm -lavfi ssim -f null - 2>&1 | grep -o 'All:[0-9.]*' | cut -d: -f2)
+echo "SSIM at render scale 0.5: $ssim"
+if ! awk -v ssim="$ssim" 'BEGIN { exit !(ssim >= 0.85) }'; then
+    echo "The frames rendered at scale 0.5 differ too much from the ones at full resolution"
+    exit 1
+fi
 
 echo "Duration: $duration"
-echo "Frames: $frames"
 echo "Framerate: $framerate"
 
-ffmpeg -threads 1 -loglevel verbose -framerate $framerate \
-    -i "$DREAMRENDER_HEADLESS_OUTPUT_DIR"/"%$format_spec.bmp" \
-    -c:v vp9 -cpu-used 5 build/test-output.webm \
+ffmpeg -threads 1 -loglevel verbose -i build/test-output.webm \
     -loop 65535 -compression_level 2 -quality 75 build/test-output.webp
@@ -56,8 +56,10 @@ export namespace av {
     using av::OutputFormat;
     using av::Packet;
     using av::PixelFormat;
+    using av::Rational;
     using av::set_logging_level;
     using av::Stream;
+    using av::Timestamp;
     using av::VideoDecoderContext;
     using av::VideoEncoderContext;
     using av::VideoFrame;
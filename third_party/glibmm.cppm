@@ -23,6 +23,7 @@ export module glibmm;
 export namespace Glib {
     using Glib::Error;
     using Glib::ustring;
+    using Glib::Checksum;
     using Glib::RefPtr;
     using Glib::setenv;
     using Glib::get_host_name;